@@ -0,0 +1,196 @@
+#include "par/parallel.h"
+
+#include <clara.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// the task representation used before tasks stored their callable inline:
+// the work and the std::function are separate allocations and every call
+// goes through both
+class StdFunctionWork : public par::Work {
+public:
+  StdFunctionWork(std::function<void()> func)
+      : Work{}, _func{std::move(func)} {}
+
+  void call() override { _func(); }
+
+private:
+  std::function<void()> _func;
+};
+
+struct Timing {
+  double create_ns = 0.;
+  double run_ns = 0.;
+};
+
+using Clock = std::chrono::steady_clock;
+
+double ns_per_task(Clock::time_point start, Clock::time_point stop,
+                   size_t nb_tasks) {
+  const auto duration =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start);
+  return static_cast<double>(duration.count()) / static_cast<double>(nb_tasks);
+}
+
+// creates nb_tasks independent tasks with make_work and runs them as one graph
+template <class MakeWork>
+Timing measure(par::Executor &executor, size_t nb_tasks, bool use_arena,
+               MakeWork make_work) {
+  // the arena grows by itself, like it does for the tasks of a frame
+  auto arena = use_arena ? std::make_shared<par::TaskArena>()
+                         : std::shared_ptr<par::TaskArena>{};
+  auto graph = par::TaskGraph{arena};
+  graph.reserve(nb_tasks);
+  const auto start = Clock::now();
+  for (size_t i = 0; i < nb_tasks; ++i) {
+    graph.add_task(make_work(i, arena));
+  }
+  const auto created = Clock::now();
+  executor.run(graph).wait();
+  const auto finished = Clock::now();
+  return {ns_per_task(start, created, nb_tasks),
+          ns_per_task(created, finished, nb_tasks)};
+}
+
+// submits nb_tasks tasks from nb_producers threads at the same time, returns
+// the time until all of them are submitted per task
+double measure_submission(par::Executor &executor, size_t nb_tasks,
+                          size_t nb_producers) {
+  std::atomic<size_t> nb_finished{0};
+  std::vector<std::thread> producers;
+  const auto start = Clock::now();
+  for (size_t producer = 0; producer < nb_producers; ++producer) {
+    producers.emplace_back([&, producer]() {
+      for (size_t i = producer; i < nb_tasks; i += nb_producers) {
+        executor.run(par::make_task([&nb_finished]() { nb_finished++; }));
+      }
+    });
+  }
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  const auto submitted = Clock::now();
+  while (nb_finished < nb_tasks) {
+    std::this_thread::yield();
+  }
+  return ns_per_task(start, submitted, nb_tasks);
+}
+
+void print(const std::string &name, const Timing &result) {
+  std::cout << std::left << std::setw(24) << name << std::right
+            << std::setw(12) << std::fixed << std::setprecision(1)
+            << result.create_ns << std::setw(12) << result.run_ns
+            << std::setw(12) << result.create_ns + result.run_ns << '\n';
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  using namespace clara;
+
+  int nb_tasks = 200000;
+  int nb_threads = 1;
+  int nb_repetitions = 5;
+  int nb_producers = 4;
+  bool help = false;
+  auto cli = Opt(nb_tasks, "tasks")["-n"]["--tasks"](
+                 "The number of tasks per graph") |
+             Opt(nb_threads, "threads")["-t"]["--threads"](
+                 "The number of executor threads") |
+             Opt(nb_repetitions, "repetitions")["-r"]["--repetitions"](
+                 "The number of runs, the best one is reported") |
+             Opt(nb_producers, "producers")["-p"]["--producers"](
+                 "The maximum number of threads submitting tasks") |
+             Help(help);
+
+  auto result = cli.parse(Args(argc, argv));
+  if (!result) {
+    std::cerr << "Error in command line: " << result.errorMessage() << '\n';
+    exit(1);
+  }
+  if (help) {
+    std::cout << cli;
+    exit(0);
+  }
+
+  const auto size = static_cast<size_t>(nb_tasks);
+  auto executor = par::Executor{nb_threads};
+  std::atomic<size_t> sum{0};
+  // captures more than fits into the small buffer of std::function
+  const auto payload = [&sum](size_t i) {
+    return [&sum, i, j = i * 2, k = i * 3]() {
+      sum.fetch_add(i + j + k, std::memory_order_relaxed);
+    };
+  };
+
+  const auto std_function_work =
+      [&payload](size_t i, const std::shared_ptr<par::TaskArena> &) {
+        return par::Task{std::make_shared<StdFunctionWork>(payload(i))};
+      };
+  const auto inline_work = [&payload](
+                               size_t i,
+                               const std::shared_ptr<par::TaskArena> &arena) {
+    return par::make_task(payload(i), nullptr, arena);
+  };
+
+  auto best = [](Timing lhs, const Timing &rhs) {
+    if (rhs.create_ns + rhs.run_ns < lhs.create_ns + lhs.run_ns) {
+      return rhs;
+    }
+    return lhs;
+  };
+  auto direct = Timing{1e9, 1e9};
+  auto std_function = direct;
+  auto inline_heap = direct;
+  auto inline_arena = direct;
+  for (int repetition = 0; repetition < nb_repetitions; ++repetition) {
+    const auto start = Clock::now();
+    for (size_t i = 0; i < size; ++i) {
+      payload(i)();
+    }
+    direct = best(direct, {0., ns_per_task(start, Clock::now(), size)});
+    std_function = best(std_function,
+                        measure(executor, size, false, std_function_work));
+    inline_heap =
+        best(inline_heap, measure(executor, size, false, inline_work));
+    inline_arena =
+        best(inline_arena, measure(executor, size, true, inline_work));
+  }
+
+  std::cout << nb_tasks << " tasks, " << nb_threads
+            << " threads, ns per task\n"
+            << std::left << std::setw(24) << "" << std::right << std::setw(12)
+            << "create" << std::setw(12) << "run" << std::setw(12) << "total"
+            << '\n';
+  print("direct call", direct);
+  print("std::function work", std_function);
+  print("inline work", inline_heap);
+  print("inline work in arena", inline_arena);
+
+  std::cout << "\nsubmission from concurrent producers, ns per task\n";
+  for (int producers = 1; producers <= nb_producers; producers *= 2) {
+    auto submission_ns = 1e9;
+    for (int repetition = 0; repetition < nb_repetitions; ++repetition) {
+      submission_ns =
+          std::min(submission_ns,
+                   measure_submission(executor, size,
+                                      static_cast<size_t>(producers)));
+    }
+    std::cout << std::left << std::setw(24)
+              << std::to_string(producers) + " producers" << std::right
+              << std::setw(12) << submission_ns << '\n';
+  }
+  return sum.load() == 0 ? 1 : 0;
+}
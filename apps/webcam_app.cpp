@@ -1,4 +1,5 @@
 #include "detection/Detection.h"
+#include "par/Coroutine.h"
 #include "par/parallel.h"
 #include "webcam/webcam.h"
 
@@ -7,11 +8,86 @@
 
 #include <clara.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 
 #define SINGLE_THREADED 0
 
+#if SINGLE_THREADED == 0 && PAR_COROUTINES
+#define ASYNC_FRAMES 1
+#else
+#define ASYNC_FRAMES 0
+#endif
+
+#if PAR_COROUTINES
+// detects the objects of one frame, the coroutine is suspended instead of
+// blocking a thread while the task graph of the frame runs
+par::Async<webcam::FrameData> detect_objects(par::Executor &executor,
+                                            cv::Mat imgOriginal,
+                                            od::Rectangle rectangle) {
+  auto frame_data = webcam::FrameData{imgOriginal};
+  auto frame_task_graph =
+      webcam::process_frame_quadview(frame_data, imgOriginal, rectangle);
+  executor.run(frame_task_graph);
+  co_await frame_task_graph;
+  co_return std::move(frame_data);
+}
+#endif
+
+// a frame handed to the executor, the results are written in capture order.
+// Its tasks refer to its members, so it must stay in place while in flight.
+struct FrameInFlight {
+  cv::Mat original;
+#if ASYNC_FRAMES
+  par::Async<webcam::FrameData> detection;
+#else
+  webcam::FrameData frame_data;
+  par::TaskGraph task_graph;
+#endif
+  par::Completion completion;
+};
+
+void prepare_frame([[maybe_unused]] par::Executor &executor,
+                   FrameInFlight &frame,
+                   [[maybe_unused]] const od::Rectangle &rectangle) {
+#if ASYNC_FRAMES
+  frame.detection = detect_objects(executor, frame.original, rectangle);
+#else
+  frame.frame_data = webcam::FrameData{frame.original};
+#if SINGLE_THREADED == 1
+  frame.task_graph =
+      webcam::process_frame_single_loop(frame.frame_data, frame.original);
+#else
+  frame.task_graph = webcam::process_frame_quadview(
+      frame.frame_data, frame.original, rectangle);
+#endif
+#endif
+}
+
+// returns false without starting the frame if the executor does not admit
+// another frame right now
+bool try_start_frame(par::Executor &executor, FrameInFlight &frame) {
+#if ASYNC_FRAMES
+  if (!executor.try_admit(1)) {
+    return false;
+  }
+  frame.completion = executor.spawn(frame.detection);
+  executor.release_on(frame.completion, 1);
+  return true;
+#else
+  const auto completion = executor.try_run(frame.task_graph);
+  if (!completion) {
+    return false;
+  }
+  frame.completion = *completion;
+  return true;
+#endif
+}
+
 int main(int argc, char **argv) {
   using namespace clara;
 
@@ -24,6 +100,7 @@ int main(int argc, char **argv) {
   int rectangle_height = -1;
   std::string path = "";
   bool short_run = false;
+  int frames_in_flight = 2;
   bool help = false;
   auto cli =
       Opt(number_webcam, "number_webcam")["-n"]["--number-webcam"](
@@ -41,7 +118,10 @@ int main(int argc, char **argv) {
           "rectangle_width")["-w"]["--rectangle-width"]("The rectangle width") |
       Opt(rectangle_height, "rectangle_height")["-h"]["--rectangle-height"](
           "The rectangle height") |
-      Opt(short_run)["-s"]["--short-run"]("Run a short run") | Help(help);
+      Opt(short_run)["-s"]["--short-run"]("Run a short run") |
+      Opt(frames_in_flight, "frames")["-f"]["--frames-in-flight"](
+          "The number of frames processed while the next one is captured") |
+      Help(help);
 
   auto result = cli.parse(Args(argc, argv));
   if (!result) {
@@ -89,29 +169,22 @@ int main(int argc, char **argv) {
 
   int i = 0;
   par::Executor executor(4);
-  while (true) {
-    cv::Mat imgOriginal;
-    int retflag;
-    webcam::read_image_data(cap, imgOriginal, retflag);
-    auto rectangle = od::Rectangle{
-        rectangle_tl_x, rectangle_tl_y,
-        rectangle_width == -1 ? imgOriginal.cols : rectangle_width,
-        rectangle_height == -1 ? imgOriginal.rows : rectangle_height};
+  // the capture is held back instead of queuing frames without limit
+  executor.set_admission_limits(
+      par::AdmissionLimits{static_cast<size_t>(std::max(frames_in_flight, 1))});
+  std::deque<std::unique_ptr<FrameInFlight>> frames;
 
-    if (retflag == 2) {
-      break;
-    }
-#if SINGLE_THREADED == 1
-    auto frame_data = webcam::FrameData{imgOriginal};
-    auto flow = webcam::process_frame_single_loop(frame_data, imgOriginal);
-    executor.run(flow);
-    executor.wait_for(flow);
+  // waits for the oldest frame and writes its results, returns false once
+  // the run should stop
+  const auto write_oldest_frame = [&]() {
+    const auto frame = std::move(frames.front());
+    frames.pop_front();
+    frame->completion.wait();
+    const auto &imgOriginal = frame->original;
+#if ASYNC_FRAMES
+    const auto frame_data = frame->detection.take_result();
 #else
-    auto frame_data = webcam::FrameData{imgOriginal};
-    auto frame_task_graph = webcam::process_frame_quadview(
-        frame_data, imgOriginal, rectangle);
-    executor.run(frame_task_graph);
-    executor.wait_for(frame_task_graph);
+    const auto &frame_data = frame->frame_data;
 #endif
 
     // draw all rectangles on copy of imgOriginal
@@ -162,15 +235,49 @@ int main(int argc, char **argv) {
     std::cout << "Frame " << ++i << " processed!" << std::endl;
 
     if (short_run && i > 10) {
-      break;
+      return false;
     }
 
     if (cv::waitKey(30) == 27) // wait for 'esc' key press for 30ms. If 'esc'
                                // key is pressed, break loop
     {
       std::cout << "esc key is pressed by user" << std::endl;
+      return false;
+    }
+    return true;
+  };
+
+  bool is_running = true;
+  while (is_running) {
+    cv::Mat imgOriginal;
+    int retflag;
+    webcam::read_image_data(cap, imgOriginal, retflag);
+    auto rectangle = od::Rectangle{
+        rectangle_tl_x, rectangle_tl_y,
+        rectangle_width == -1 ? imgOriginal.cols : rectangle_width,
+        rectangle_height == -1 ? imgOriginal.rows : rectangle_height};
+
+    if (retflag == 2) {
       break;
     }
+    auto frame = std::make_unique<FrameInFlight>();
+    frame->original = imgOriginal;
+    prepare_frame(executor, *frame, rectangle);
+    // backpressure, the capture waits for the oldest frame while too many
+    // frames are in flight
+    while (is_running && !try_start_frame(executor, *frame)) {
+      is_running = write_oldest_frame();
+    }
+    if (is_running) {
+      frames.push_back(std::move(frame));
+    }
+  }
+  while (is_running && !frames.empty()) {
+    is_running = write_oldest_frame();
+  }
+  // frames still in flight use their frame data
+  for (const auto &frame : frames) {
+    frame->completion.wait();
   }
   return 0;
 }
@@ -4,8 +4,29 @@
 
 #include "opencv2/imgproc.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <vector>
+
+// vectorized gradient rows for x86 compilers supporting target attributes,
+// the instruction set is chosen at runtime
+#ifndef DETECTION_SIMD
+#if (defined(__x86_64__) || defined(__i386__)) &&                              \
+    (defined(__GNUC__) || defined(__clang__))
+#define DETECTION_SIMD 1
+#else
+#define DETECTION_SIMD 0
+#endif
+#endif
+
+#if DETECTION_SIMD
+#include <immintrin.h>
+#endif
 
 namespace detail {
 
@@ -17,31 +38,30 @@ enum class DetectionType {
 
 static int logCounter = 0;
 /**
- * returns the gradient over a pixel
- * first calculate the x and y gradients over the pixel cc
- * then return the sqrt(grad_x**2 + grad_y**2)
+ * the x and y gradients over a pixel and their length, from the 8 neighbours
+ * of the pixel. Shared by the scalar and the vectorized rows, which round
+ * every operation the same way.
  */
-template <DetectionType detectionType, int threshold>
-inline auto gradient(int tl, int tc, int tr, int cl, int cc, int cr, int bl,
-                     int bc, int br) {
-  int grad = 0;
+inline void gradient_components(int tl, int tc, int tr, int cl, int cr, int bl,
+                                int bc, int br, float &grad_x, float &grad_y,
+                                float &grad_total) {
   float grad_tl_br = br - tl;
   float grad_cl_cr = cr - cl;
   float grad_bl_tr = tr - bl;
   float grad_bc_tc = tc - bc;
   float sqrt2 = 1.0 / std::sqrt(2.0);
-  float grad_x = grad_cl_cr + grad_tl_br * sqrt2 + grad_bl_tr * sqrt2;
-  float grad_y = -grad_bc_tc + grad_tl_br * sqrt2 - grad_bl_tr * sqrt2;
-  float grad_total = std::sqrt(grad_x * grad_x + grad_y * grad_y);
-  grad = int(grad_total);
-  if constexpr (false) {
-    std::cout << "gradient of:\n";
-    std::cout << tl << " " << tc << " " << tl << '\n';
-    std::cout << cl << " " << cc << " " << cl << '\n';
-    std::cout << bl << " " << bc << " " << bl << '\n';
-    std::cout << "grad_x = " << grad_x << "; grad_y = " << grad_y << "\n";
-    std::cout << "grad = " << grad << '\n';
-  }
+  grad_x = grad_cl_cr + grad_tl_br * sqrt2 + grad_bl_tr * sqrt2;
+  grad_y = -grad_bc_tc + grad_tl_br * sqrt2 - grad_bl_tr * sqrt2;
+  grad_total = std::sqrt(grad_x * grad_x + grad_y * grad_y);
+}
+
+/**
+ * returns the gradient of a pixel from its gradient components, for angles
+ * also the direction in degrees
+ */
+template <DetectionType detectionType, int threshold>
+inline auto gradient_of(float grad_x, float grad_y, float grad_total) {
+  int grad = int(grad_total);
   if constexpr (detectionType == DetectionType::Edge)
     return grad;
   else {
@@ -60,6 +80,161 @@ inline auto gradient(int tl, int tc, int tr, int cl, int cc, int cr, int bl,
     return std::pair<int, int>{grad, degrees_ret};
   }
 }
+
+/**
+ * returns the gradient over a pixel
+ * first calculate the x and y gradients over the pixel cc
+ * then return the sqrt(grad_x**2 + grad_y**2)
+ */
+template <DetectionType detectionType, int threshold>
+inline auto gradient(int tl, int tc, int tr, int cl, [[maybe_unused]] int cc,
+                     int cr, int bl, int bc, int br) {
+  float grad_x = 0;
+  float grad_y = 0;
+  float grad_total = 0;
+  gradient_components(tl, tc, tr, cl, cr, bl, bc, br, grad_x, grad_y,
+                      grad_total);
+  if constexpr (false) {
+    std::cout << "gradient of:\n";
+    std::cout << tl << " " << tc << " " << tl << '\n';
+    std::cout << cl << " " << cc << " " << cl << '\n';
+    std::cout << bl << " " << bc << " " << bl << '\n';
+    std::cout << "grad_x = " << grad_x << "; grad_y = " << grad_y << "\n";
+    std::cout << "grad = " << int(grad_total) << '\n';
+  }
+  return gradient_of<detectionType, threshold>(grad_x, grad_y, grad_total);
+}
+
+/**
+ * computes the gradient components of nb_pixels neighbouring pixels of a gray
+ * row. up, center and down point to the left neighbour of the first pixel in
+ * the rows above, at and below the pixels, so nb_pixels + 2 values are read
+ * from each of them.
+ */
+using GradientRow = void (*)(const uchar *up, const uchar *center,
+                             const uchar *down, int nb_pixels, float *grad_x,
+                             float *grad_y, float *grad_total);
+
+inline void gradient_row_scalar(const uchar *up, const uchar *center,
+                                const uchar *down, int nb_pixels,
+                                float *grad_x, float *grad_y,
+                                float *grad_total) {
+  for (int k = 0; k < nb_pixels; ++k) {
+    gradient_components(up[k], up[k + 1], up[k + 2], center[k], center[k + 2],
+                        down[k], down[k + 1], down[k + 2], grad_x[k],
+                        grad_y[k], grad_total[k]);
+  }
+}
+
+#if DETECTION_SIMD
+// the vectorized rows use the operations of gradient_components in the same
+// order, without fused multiply adds, and are bit-identical to it
+__attribute__((target("sse4.1"))) inline __m128i
+load_pixels_sse41(const uchar *pixels) {
+  std::int32_t packed = 0;
+  std::memcpy(&packed, pixels, sizeof(packed));
+  return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed));
+}
+
+__attribute__((target("sse4.1"))) inline __m128
+difference_sse41(const uchar *to, const uchar *from) {
+  return _mm_cvtepi32_ps(
+      _mm_sub_epi32(load_pixels_sse41(to), load_pixels_sse41(from)));
+}
+
+__attribute__((target("sse4.1"))) inline void
+gradient_row_sse41(const uchar *up, const uchar *center, const uchar *down,
+                   int nb_pixels, float *grad_x, float *grad_y,
+                   float *grad_total) {
+  const float sqrt2 = 1.0 / std::sqrt(2.0);
+  const auto sqrt2s = _mm_set1_ps(sqrt2);
+  const auto sign = _mm_set1_ps(-0.0f);
+  int k = 0;
+  for (; k + 4 <= nb_pixels; k += 4) {
+    const auto grad_tl_br = difference_sse41(down + k + 2, up + k);
+    const auto grad_cl_cr = difference_sse41(center + k + 2, center + k);
+    const auto grad_bl_tr = difference_sse41(up + k + 2, down + k);
+    const auto grad_bc_tc = difference_sse41(up + k + 1, down + k + 1);
+    const auto diagonal_tl_br = _mm_mul_ps(grad_tl_br, sqrt2s);
+    const auto diagonal_bl_tr = _mm_mul_ps(grad_bl_tr, sqrt2s);
+    const auto x = _mm_add_ps(_mm_add_ps(grad_cl_cr, diagonal_tl_br),
+                              diagonal_bl_tr);
+    const auto y = _mm_sub_ps(
+        _mm_add_ps(_mm_xor_ps(grad_bc_tc, sign), diagonal_tl_br),
+        diagonal_bl_tr);
+    const auto total =
+        _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+    _mm_storeu_ps(grad_x + k, x);
+    _mm_storeu_ps(grad_y + k, y);
+    _mm_storeu_ps(grad_total + k, total);
+  }
+  gradient_row_scalar(up + k, center + k, down + k, nb_pixels - k, grad_x + k,
+                      grad_y + k, grad_total + k);
+}
+
+__attribute__((target("avx2"))) inline __m256i
+load_pixels_avx2(const uchar *pixels) {
+  return _mm256_cvtepu8_epi32(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i *>(pixels)));
+}
+
+__attribute__((target("avx2"))) inline __m256
+difference_avx2(const uchar *to, const uchar *from) {
+  return _mm256_cvtepi32_ps(
+      _mm256_sub_epi32(load_pixels_avx2(to), load_pixels_avx2(from)));
+}
+
+__attribute__((target("avx2"))) inline void
+gradient_row_avx2(const uchar *up, const uchar *center, const uchar *down,
+                  int nb_pixels, float *grad_x, float *grad_y,
+                  float *grad_total) {
+  const float sqrt2 = 1.0 / std::sqrt(2.0);
+  const auto sqrt2s = _mm256_set1_ps(sqrt2);
+  const auto sign = _mm256_set1_ps(-0.0f);
+  int k = 0;
+  for (; k + 8 <= nb_pixels; k += 8) {
+    const auto grad_tl_br = difference_avx2(down + k + 2, up + k);
+    const auto grad_cl_cr = difference_avx2(center + k + 2, center + k);
+    const auto grad_bl_tr = difference_avx2(up + k + 2, down + k);
+    const auto grad_bc_tc = difference_avx2(up + k + 1, down + k + 1);
+    const auto diagonal_tl_br = _mm256_mul_ps(grad_tl_br, sqrt2s);
+    const auto diagonal_bl_tr = _mm256_mul_ps(grad_bl_tr, sqrt2s);
+    const auto x = _mm256_add_ps(_mm256_add_ps(grad_cl_cr, diagonal_tl_br),
+                                 diagonal_bl_tr);
+    const auto y = _mm256_sub_ps(
+        _mm256_add_ps(_mm256_xor_ps(grad_bc_tc, sign), diagonal_tl_br),
+        diagonal_bl_tr);
+    const auto total = _mm256_sqrt_ps(
+        _mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)));
+    _mm256_storeu_ps(grad_x + k, x);
+    _mm256_storeu_ps(grad_y + k, y);
+    _mm256_storeu_ps(grad_total + k, total);
+  }
+  // the remaining pixels of the row fit into the narrower vectors
+  gradient_row_sse41(up + k, center + k, down + k, nb_pixels - k, grad_x + k,
+                     grad_y + k, grad_total + k);
+}
+#endif
+
+// the widest gradient row the cpu supports, chosen once
+inline GradientRow get_gradient_row() {
+#if DETECTION_SIMD
+  static const auto gradient_row = []() -> GradientRow {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      return gradient_row_avx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+      return gradient_row_sse41;
+    }
+    return gradient_row_scalar;
+  }();
+  return gradient_row;
+#else
+  return gradient_row_scalar;
+#endif
+}
+
 /**
  * returns a gray scale Mat, takes an BGR / RGB Mat
  * iterate over all pixels and calculate the color gradient over it
@@ -84,12 +259,14 @@ inline void detect_edges(cv::Mat &ret, cv::Mat const &bgrImg,
   cv::Mat grayImage;
   cv::cvtColor(roi, grayImage, cv::COLOR_RGB2GRAY);
 
-  const auto get_checked = [grayImage](int i, int j){
-    if(i < 0 || i >= grayImage.rows || j < 0 || j >= grayImage.cols){
-      throw std::runtime_error("Index out of bounds i:" + std::to_string(i) + "; j:" + std::to_string(j) + "; rows:" + std::to_string(grayImage.rows) + "; cols:" + std::to_string(grayImage.cols));
-    }
-    return static_cast<int>(grayImage.at<uchar>(i, j));
-  };
+  // the gradient components are computed a row segment at a time into stack
+  // buffers, the roi keeps all neighbours of its inner pixels in bounds
+  constexpr int nb_segment_pixels = 256;
+  std::array<float, nb_segment_pixels> grad_x;
+  std::array<float, nb_segment_pixels> grad_y;
+  std::array<float, nb_segment_pixels> grad_total;
+  const auto gradient_row = get_gradient_row();
+  const auto nb_pixels = std::max(grayImage.cols - 2, 0);
 
   cv::Vec3b *retCenter;
   int y = 1;
@@ -99,57 +276,57 @@ inline void detect_edges(cv::Mat &ret, cv::Mat const &bgrImg,
                   detectionType == DetectionType::Angle) {
       retCenter = ret.ptr<cv::Vec3b>(i);
     }
-    int x = 1;
-    for (int j = roiRect.x + 1;
-         j < roiRect.x + roiRect.width - 1; ++j) {
-      int degrees = 0;
-      auto ret_val = gradient<detectionType, 0>(
-          get_checked(y - 1, x - 1),
-          get_checked(y - 1, x),
-          get_checked(y - 1, x + 1),
-          get_checked(y, x - 1),
-          get_checked(y, x),
-          get_checked(y, x + 1),
-          get_checked(y + 1, x - 1),
-          get_checked(y + 1, x),
-          get_checked(y + 1, x + 1));
-      int grad_c = 0;
-      if constexpr (detectionType == DetectionType::Edge) {
-        grad_c = ret_val;
-      } else {
-        grad_c = ret_val.first;
-        degrees = ret_val.second;
-      }
-      auto val = float(grad_c);
-
-      if constexpr (detectionType == DetectionType::Edge) {
-        ret.at<uchar>(i, j) = int(val);
-      } else if (detectionType == DetectionType::Gradient) {
-        retCenter[j][0] = int(val);
-        if (degrees >= 0) {
-          retCenter[j][1] = degrees;
-          retCenter[j][2] = 0;
+    const auto *up = grayImage.ptr<uchar>(y - 1);
+    const auto *center = grayImage.ptr<uchar>(y);
+    const auto *down = grayImage.ptr<uchar>(y + 1);
+    for (int first = 0; first < nb_pixels; first += nb_segment_pixels) {
+      const auto nb_pixels_in_segment =
+          std::min(nb_segment_pixels, nb_pixels - first);
+      gradient_row(up + first, center + first, down + first,
+                   nb_pixels_in_segment, grad_x.data(), grad_y.data(),
+                   grad_total.data());
+      for (int x = 0; x < nb_pixels_in_segment; ++x) {
+        const int j = roiRect.x + 1 + first + x;
+        int degrees = 0;
+        auto ret_val = gradient_of<detectionType, 0>(
+            grad_x[x], grad_y[x], grad_total[x]);
+        int grad_c = 0;
+        if constexpr (detectionType == DetectionType::Edge) {
+          grad_c = ret_val;
         } else {
-          retCenter[j][1] = 0;
-          retCenter[j][2] = -degrees;
+          grad_c = ret_val.first;
+          degrees = ret_val.second;
         }
-      } else {
-        retCenter[j][0] = 255;
-        retCenter[j][1] = 255;
-        retCenter[j][2] = 255;
-        if (val > 0) {
+        auto val = float(grad_c);
+
+        if constexpr (detectionType == DetectionType::Edge) {
+          ret.at<uchar>(i, j) = int(val);
+        } else if (detectionType == DetectionType::Gradient) {
+          retCenter[j][0] = int(val);
           if (degrees >= 0) {
-            retCenter[j][0] = int(float(degrees) * 256.0 / 180.0);
-            retCenter[j][1] = 0;
+            retCenter[j][1] = degrees;
             retCenter[j][2] = 0;
           } else {
-            retCenter[j][0] = 0;
-            retCenter[j][1] = int(float(-degrees) * 256.0 / 180.0);
-            retCenter[j][2] = 0;
+            retCenter[j][1] = 0;
+            retCenter[j][2] = -degrees;
+          }
+        } else {
+          retCenter[j][0] = 255;
+          retCenter[j][1] = 255;
+          retCenter[j][2] = 255;
+          if (val > 0) {
+            if (degrees >= 0) {
+              retCenter[j][0] = int(float(degrees) * 256.0 / 180.0);
+              retCenter[j][1] = 0;
+              retCenter[j][2] = 0;
+            } else {
+              retCenter[j][0] = 0;
+              retCenter[j][1] = int(float(-degrees) * 256.0 / 180.0);
+              retCenter[j][2] = 0;
+            }
           }
         }
       }
-      x++;
     }
     y++;
   }
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace par {
+
+// parses linux cpu lists like "0-3,8,10-11"
+inline std::vector<int> parse_cpu_list(const std::string &cpu_list) {
+  std::vector<int> cpus;
+  auto sstream = std::istringstream{cpu_list};
+  std::string range;
+  while (std::getline(sstream, range, ',')) {
+    if (range.empty() || range == "\n") {
+      continue;
+    }
+    const auto dash = range.find('-');
+    try {
+      const auto first = std::stoi(range.substr(0, dash));
+      const auto last =
+          dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+      for (int cpu = first; cpu <= last; ++cpu) {
+        cpus.push_back(cpu);
+      }
+    } catch (const std::exception &) {
+      return {};
+    }
+  }
+  return cpus;
+}
+
+inline std::vector<int> read_cpu_list(const std::string &path) {
+  auto file = std::ifstream{path};
+  std::string cpu_list;
+  std::getline(file, cpu_list);
+  return parse_cpu_list(cpu_list);
+}
+
+// placement of the executor workers on cpu cores, workers are assigned to the
+// cores round-robin
+class Affinity {
+public:
+  Affinity() = default;
+
+  static Affinity cores(std::vector<int> cores) {
+    auto affinity = Affinity{};
+    affinity._cores = std::move(cores);
+    return affinity;
+  }
+
+  // all cores of the numa node as listed in sysfs
+  static Affinity numa_node(int node) {
+    return cores(read_cpu_list("/sys/devices/system/node/node" +
+                               std::to_string(node) + "/cpulist"));
+  }
+
+  bool is_pinned() const { return !_cores.empty(); }
+
+  // the core of the worker or -1 if the worker is not pinned
+  int core_of_worker(size_t worker_index) const {
+    if (_cores.empty()) {
+      return -1;
+    }
+    return _cores[worker_index % _cores.size()];
+  }
+
+private:
+  std::vector<int> _cores;
+};
+
+// returns false if the thread could not be pinned to the core
+inline bool pin_thread([[maybe_unused]] std::thread &thread,
+                       [[maybe_unused]] int core) {
+#ifdef __linux__
+  if (core < 0 || core >= CPU_SETSIZE) {
+    return false;
+  }
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(core, &cpu_set);
+  return pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t),
+                                &cpu_set) == 0;
+#else
+  return false;
+#endif
+}
+
+} // namespace par
@@ -5,78 +5,131 @@
 #include "par/Executor.h"
 
 #include <cassert>
+#include <functional>
+#include <optional>
 #include <type_traits>
+#include <utility>
 
 namespace par {
 
 template<typename> class CalcImpl;
 
+namespace detail {
+// the stored argument of a calc as it is passed to its function
+template <typename TArg, typename Arg> decltype(auto) pass_arg(Arg &arg) {
+  if constexpr (std::is_rvalue_reference_v<TArg> ||
+                !std::is_copy_constructible_v<Arg>) {
+    return std::move(arg);
+  } else {
+    return static_cast<Arg &>(arg);
+  }
+}
+} // namespace detail
+
+// results and arguments are held in place, so move-only types work. The
+// argument stays with the calc and is passed to the function as an lvalue on
+// every call, only a calc taking it by rvalue reference or taking a move-only
+// value moves it out and can run once.
 template <typename TResult, typename TArg>
 struct CalcImpl<TResult(TArg)> : public Work {
+  using ArgValue = std::decay_t<TArg>;
+
   CalcImpl() = default;
-  CalcImpl(std::function<TResult(TArg)> func) : _func{func} {}
-  CalcImpl(const CalcImpl &) = default;
-  CalcImpl(CalcImpl &&) = default;
-  CalcImpl &operator=(const CalcImpl &) = default;
-  CalcImpl &operator=(CalcImpl &&) = default;
+  CalcImpl(std::function<TResult(TArg)> func) : _func{std::move(func)} {}
+  CalcImpl(const CalcImpl &) = delete;
+  CalcImpl(CalcImpl &&) = delete;
+  CalcImpl &operator=(const CalcImpl &) = delete;
+  CalcImpl &operator=(CalcImpl &&) = delete;
   virtual ~CalcImpl() = default;
 
-  void call() override { _result = _func(_arg); }
+  void call() override {
+    assert(_arg.has_value());
+    _result.emplace(_func(detail::pass_arg<TArg>(*_arg)));
+  }
 
-  TResult result() const { return _result; }
-  TArg arg() const { return _arg; }
-  void set_arg(TArg arg) { _arg = arg; }
+  // valid until the result is taken
+  const TResult &result() const {
+    assert(_result.has_value());
+    return *_result;
+  }
+  TResult take_result() {
+    assert(_result.has_value());
+    auto result = std::move(*_result);
+    _result.reset();
+    return result;
+  }
+  const ArgValue &arg() const { return *_arg; }
+  template <typename Arg> void set_arg(Arg &&arg) {
+    _arg.emplace(std::forward<Arg>(arg));
+  }
 private:
   std::function<TResult(TArg)> _func;
-  TResult _result;
-  TArg _arg;
+  std::optional<TResult> _result;
+  std::optional<ArgValue> _arg;
 };
 
 template <typename TResult>
 struct CalcImpl<TResult()> : public Work {
   CalcImpl() = default;
-  CalcImpl(std::function<TResult()> func) : _func{func} {}
-  CalcImpl(const CalcImpl &) = default;
-  CalcImpl(CalcImpl &&) = default;
-  CalcImpl &operator=(const CalcImpl &) = default;
-  CalcImpl &operator=(CalcImpl &&) = default;
+  CalcImpl(std::function<TResult()> func) : _func{std::move(func)} {}
+  CalcImpl(const CalcImpl &) = delete;
+  CalcImpl(CalcImpl &&) = delete;
+  CalcImpl &operator=(const CalcImpl &) = delete;
+  CalcImpl &operator=(CalcImpl &&) = delete;
   virtual ~CalcImpl() = default;
 
-  void call() override { _result = _func(); }
+  void call() override { _result.emplace(_func()); }
 
-  TResult result() const { return _result; }
+  // valid until the result is taken
+  const TResult &result() const {
+    assert(_result.has_value());
+    return *_result;
+  }
+  TResult take_result() {
+    assert(_result.has_value());
+    auto result = std::move(*_result);
+    _result.reset();
+    return result;
+  }
 private:
   std::function<TResult()> _func;
-  TResult _result;
+  std::optional<TResult> _result;
 };
 
 template <typename TArg>
 struct CalcImpl<void(TArg)> : public Work {
+  using ArgValue = std::decay_t<TArg>;
+
   CalcImpl() = default;
-  CalcImpl(std::function<void(TArg)> func) : _func{func} {}
-  CalcImpl(const CalcImpl &) = default;
-  CalcImpl(CalcImpl &&) = default;
-  CalcImpl &operator=(const CalcImpl &) = default;
-  CalcImpl &operator=(CalcImpl &&) = default;
+  CalcImpl(std::function<void(TArg)> func) : _func{std::move(func)} {}
+  CalcImpl(const CalcImpl &) = delete;
+  CalcImpl(CalcImpl &&) = delete;
+  CalcImpl &operator=(const CalcImpl &) = delete;
+  CalcImpl &operator=(CalcImpl &&) = delete;
   virtual ~CalcImpl() = default;
 
-  void call() override { _func(_arg); }
+  void call() override {
+    assert(_arg.has_value());
+    _func(detail::pass_arg<TArg>(*_arg));
+  }
 
-  TArg arg() const { return _arg; }
-  void set_arg(TArg arg) { _arg = arg; }
+  const ArgValue &arg() const { return *_arg; }
+  template <typename Arg> void set_arg(Arg &&arg) {
+    _arg.emplace(std::forward<Arg>(arg));
+  }
 private:
   std::function<void(TArg)> _func;
-  TArg _arg;
+  std::optional<ArgValue> _arg;
 };
 
 template<>
 struct CalcImpl<void()> : public Work {
   CalcImpl() = default;
-  CalcImpl(std::function<void()> func) : _func{func} {}
-  CalcImpl(const CalcImpl &) = default;
-  CalcImpl(CalcImpl &&) = default;
-  CalcImpl &operator=(const CalcImpl &) = default;
-  CalcImpl &operator=(CalcImpl &&) = default;
+  CalcImpl(std::function<void()> func) : _func{std::move(func)} {}
+  CalcImpl(const CalcImpl &) = delete;
+  CalcImpl(CalcImpl &&) = delete;
+  CalcImpl &operator=(const CalcImpl &) = delete;
+  CalcImpl &operator=(CalcImpl &&) = delete;
   virtual ~CalcImpl() = default;
 
   void call() override { _func(); }
@@ -91,7 +144,7 @@ template<>
 struct Calc<void()> {
   Calc() : _impl{std::make_shared<CalcImpl<void()>>()} {}
   Calc(std::function<void()> func)
-      : _impl{std::make_shared<CalcImpl<void()>>(func)} {}
+      : _impl{std::make_shared<CalcImpl<void()>>(std::move(func))} {}
   Calc(const Calc &) = default;
   Calc(Calc &&) = default;
   Calc &operator=(const Calc &) = default;
@@ -113,7 +166,7 @@ template <typename TResult, typename TArg>
 struct Calc<TResult(TArg)> {
   Calc() : _impl{std::make_shared<CalcImpl<TResult(TArg)>>()} {}
   Calc(std::function<TResult(TArg)> func)
-      : _impl{std::make_shared<CalcImpl<TResult(TArg)>>(func)} {}
+      : _impl{std::make_shared<CalcImpl<TResult(TArg)>>(std::move(func))} {}
   Calc(const Calc &) = default;
   Calc(Calc &&) = default;
   Calc &operator=(const Calc &) = default;
@@ -123,16 +176,18 @@ struct Calc<TResult(TArg)> {
     return Task{_impl};
   }
 
+  // continuations get a copy of the result, so that a calc may have several
+  // of them. Move-only results are moved to the continuation.
   Calc<void()> then(Executor& executor, std::function<void(TResult)> continuation)
   {
-    auto this_calc = *this;
-    auto func = [this_calc, continuation]() {
+    auto func = [this_calc = *this, continuation = std::move(continuation)]() {
       assert(this_calc.is_finished());
-      continuation(this_calc.result());
+      continuation(this_calc.continuation_result());
     };
     auto continuation_calc = Calc<void()>(func);
     auto continuation_task = continuation_calc.make_task();
-    continuation_task.succeed(this->make_task());
+    auto this_task = make_task();
+    continuation_task.succeed(this_task);
     executor.run(continuation_task);
     return continuation_calc;
   }
@@ -140,27 +195,47 @@ struct Calc<TResult(TArg)> {
   template<typename ThenResult>
   Calc<ThenResult()> then(Executor& executor, std::function<ThenResult(TResult)> continuation)
   {
-    auto this_calc = *this;
-    auto func = [this_calc, continuation]() {
+    auto func = [this_calc = *this, continuation = std::move(continuation)]() {
       assert(this_calc.is_finished());
-      return continuation(this_calc.result());
+      return continuation(this_calc.continuation_result());
     };
     auto continuation_calc = Calc<ThenResult()>(func);
     auto continuation_task = continuation_calc.make_task();
-    continuation_task.succeed(this->make_task());
+    auto this_task = make_task();
+    continuation_task.succeed(this_task);
     executor.run(continuation_task);
     return continuation_calc;
   }
 
-  TResult result() const {
+  // valid until the result is taken
+  const TResult &result() const {
     return _impl->result();
   }
 
+  // moves the result out, at most once per run of the calc
+  TResult take_result() const {
+    return _impl->take_result();
+  }
+
   bool is_finished() const {
     return _impl->is_finished();
   }
 
+  // must be set before the calc is run
+  template <typename Arg> void set_arg(Arg &&arg) const {
+    _impl->set_arg(std::forward<Arg>(arg));
+  }
+
 private:
+  // the result handed to a continuation
+  TResult continuation_result() const {
+    if constexpr (std::is_copy_constructible_v<TResult>) {
+      return _impl->result();
+    } else {
+      return _impl->take_result();
+    }
+  }
+
   std::shared_ptr<CalcImpl<TResult(TArg)>> _impl;
 };
 
@@ -168,7 +243,7 @@ template <typename TResult>
 struct Calc<TResult()> {
   Calc() : _impl{std::make_shared<CalcImpl<TResult()>>()} {}
   Calc(std::function<TResult()> func)
-      : _impl{std::make_shared<CalcImpl<TResult()>>(func)} {}
+      : _impl{std::make_shared<CalcImpl<TResult()>>(std::move(func))} {}
   Calc(const Calc &) = default;
   Calc(Calc &&) = default;
   Calc &operator=(const Calc &) = default;
@@ -178,12 +253,13 @@ struct Calc<TResult()> {
     return Task{_impl};
   }
 
+  // continuations get a copy of the result, so that a calc may have several
+  // of them. Move-only results are moved to the continuation.
   Calc<void()> then(Executor& executor, std::function<void(TResult)> continuation)
   {
-    auto this_calc = *this;
-    auto func = [this_calc, continuation]() {
+    auto func = [this_calc = *this, continuation = std::move(continuation)]() {
       assert(this_calc.is_finished());
-      continuation(this_calc.result());
+      continuation(this_calc.continuation_result());
     };
     auto continuation_calc = Calc<void()>(func);
     auto continuation_task = continuation_calc.make_task();
@@ -196,10 +272,9 @@ struct Calc<TResult()> {
   template<typename ThenResult>
   Calc<ThenResult()> then(Executor& executor, std::function<ThenResult(TResult)> continuation)
   {
-    auto this_calc = *this;
-    auto func = [this_calc, continuation]() {
+    auto func = [this_calc = *this, continuation = std::move(continuation)]() {
       assert(this_calc.is_finished());
-      return continuation(this_calc.result());
+      return continuation(this_calc.continuation_result());
     };
     auto continuation_calc = Calc<ThenResult()>(func);
     auto continuation_task = continuation_calc.make_task();
@@ -209,16 +284,31 @@ struct Calc<TResult()> {
     return continuation_calc;
   }
 
-  TResult result() const {
+  // valid until the result is taken
+  const TResult &result() const {
     return _impl->result();
   }
 
+  // moves the result out, at most once per run of the calc
+  TResult take_result() const {
+    return _impl->take_result();
+  }
+
   bool is_finished() const {
     return _impl->is_finished();
   }
 
 
 private:
+  // the result handed to a continuation
+  TResult continuation_result() const {
+    if constexpr (std::is_copy_constructible_v<TResult>) {
+      return _impl->result();
+    } else {
+      return _impl->take_result();
+    }
+  }
+
   std::shared_ptr<CalcImpl<TResult()>> _impl;
 };
 
@@ -227,7 +317,7 @@ template <typename TArg>
 struct Calc<void(TArg)> {
   Calc() : _impl{std::make_shared<CalcImpl<void(TArg)>>()} {}
   Calc(std::function<void(TArg)> func)
-      : _impl{std::make_shared<CalcImpl<void(TArg)>>(func)} {}
+      : _impl{std::make_shared<CalcImpl<void(TArg)>>(std::move(func))} {}
   Calc(const Calc &) = default;
   Calc(Calc &&) = default;
   Calc &operator=(const Calc &) = default;
@@ -242,6 +332,11 @@ struct Calc<void(TArg)> {
   }
 
 
+  // must be set before the calc is run
+  template <typename Arg> void set_arg(Arg &&arg) const {
+    _impl->set_arg(std::forward<Arg>(arg));
+  }
+
 private:
   std::shared_ptr<CalcImpl<void(TArg)>> _impl;
 };
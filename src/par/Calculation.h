@@ -1,40 +1,51 @@
 #pragma once
 
-#include "par/Work.h"
+#include "par/TaskArena.h"
 #include "par/Task.h"
+#include "par/Work.h"
 
-#include <functional>
 #include <memory>
+#include <type_traits>
+#include <utility>
 
 namespace par {
 
 class FlowImpl;
 class Task;
 
-class CalculationImpl : public Work {
+// work storing the function object inline instead of in a std::function, so
+// a task is a single allocation and calling it needs no second indirection
+template <class Func> class FunctionImpl : public Work {
 public:
-  CalculationImpl(std::function<void()> func) : Work{}, _func{func} {}
-  CalculationImpl() = default;
-  CalculationImpl(const CalculationImpl &) = default;
-  CalculationImpl(CalculationImpl &&) = default;
-  CalculationImpl &operator=(const CalculationImpl &) = default;
-  CalculationImpl &operator=(CalculationImpl &&) = default;
-  virtual ~CalculationImpl() = default;
+  FunctionImpl(Func func) : Work{}, _func{std::move(func)} {}
+  FunctionImpl(const FunctionImpl &) = delete;
+  FunctionImpl(FunctionImpl &&) = delete;
+  FunctionImpl &operator=(const FunctionImpl &) = delete;
+  FunctionImpl &operator=(FunctionImpl &&) = delete;
+  virtual ~FunctionImpl() = default;
 
   void call() override {
 #if DO_LOG
-    std::cout << "CalculationImpl::call()" << std::endl;
+    std::cout << "FunctionImpl::call()" << std::endl;
 #endif
     _func();
   }
 
-  std::function<void()> _func;
+private:
+  Func _func;
 };
 
 class Calculation {
 public:
-  Calculation(std::function<void()> func)
-      : _impl{std::make_shared<CalculationImpl>(func)} {}
+  // the label names the task in traces recorded with PAR_TRACE enabled
+  template <class Func,
+            class = std::enable_if_t<std::is_invocable_v<std::decay_t<Func> &>>>
+  Calculation(Func &&func, const char *label = nullptr,
+              const std::shared_ptr<TaskArena> &arena = nullptr)
+      : _impl{make_shared_in<FunctionImpl<std::decay_t<Func>>>(
+            arena, std::forward<Func>(func))} {
+    _impl->set_label(label);
+  }
   Calculation() = default;
   Calculation(const Calculation &) = default;
   Calculation(Calculation &&) = default;
@@ -52,9 +63,19 @@ public:
   Task make_task() { return Task{_impl}; }
 
 private:
-  std::shared_ptr<CalculationImpl> get() const { return _impl; }
-  std::shared_ptr<CalculationImpl> _impl;
+  const std::shared_ptr<Work> &get() const { return _impl; }
+  std::shared_ptr<Work> _impl;
   friend class FlowImpl;
 };
 
+// creates a task calling func with a single allocation, which comes from the
+// arena if one is given
+template <class Func>
+Task make_task(Func func, const char *label = nullptr,
+               const std::shared_ptr<TaskArena> &arena = nullptr) {
+  auto work = make_shared_in<FunctionImpl<Func>>(arena, std::move(func));
+  work->set_label(label);
+  return Task{std::move(work)};
+}
+
 }
\ No newline at end of file
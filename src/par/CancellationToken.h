@@ -0,0 +1,26 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace par {
+
+// shared flag to skip the tasks of a task graph that have not started yet,
+// copies of a token refer to the same flag
+class CancellationToken {
+public:
+  CancellationToken() = default;
+  CancellationToken(const CancellationToken &) = default;
+  CancellationToken(CancellationToken &&) = default;
+  CancellationToken &operator=(const CancellationToken &) = default;
+  CancellationToken &operator=(CancellationToken &&) = default;
+
+  void cancel() const { *_cancelled = true; }
+  bool is_cancelled() const { return *_cancelled; }
+
+private:
+  std::shared_ptr<std::atomic<bool>> _cancelled =
+      std::make_shared<std::atomic<bool>>(false);
+};
+
+} // namespace par
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "par/CancellationToken.h"
+#include "par/Task.h"
+#include "par/TaskGraph.h"
+#include "par/Work.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace par {
+
+class Executor;
+
+// slot for the input of a compiled graph, tasks read the value bound for the
+// current replay. Copies refer to the same slot.
+template <class T> class Binding {
+public:
+  Binding() = default;
+  Binding(const Binding &) = default;
+  Binding(Binding &&) = default;
+  Binding &operator=(const Binding &) = default;
+  Binding &operator=(Binding &&) = default;
+
+  void bind(T &value) const { *_value = &value; }
+  T &get() const { return **_value; }
+
+private:
+  std::shared_ptr<T *> _value = std::make_shared<T *>(nullptr);
+};
+
+// a task graph wired once, in topological order and with precomputed
+// successor lists, that can be replayed without rebuilding it. Its tasks must
+// only be run through Executor::run(CompiledGraph&).
+class CompiledGraph {
+public:
+  CompiledGraph() = default;
+  CompiledGraph(const CompiledGraph &) = delete;
+  CompiledGraph(CompiledGraph &&) = default;
+  CompiledGraph &operator=(const CompiledGraph &) = delete;
+  CompiledGraph &operator=(CompiledGraph &&) = default;
+
+  // throws std::runtime_error if the task graph contains a cycle
+  CompiledGraph(const TaskGraph &task_graph)
+      : _cancellation_token{task_graph.get_cancellation_token()} {
+    sort_topologically(collect(task_graph.get_tasks().front().get()));
+    wire();
+  }
+
+  // tasks in topological order, the finish task of the task graph comes last
+  const std::vector<Task> &get_tasks() const { return _tasks; }
+  const std::vector<Task> &get_roots() const { return _roots; }
+  const Task &get_sink() const { return _tasks.back(); }
+
+  void cancel() const { _cancellation_token.cancel(); }
+
+  // true from running a replay until all of its tasks are finished
+  bool is_running() const {
+    if (_is_reset) {
+      return false;
+    }
+    for (const auto &task : _tasks) {
+      const auto state = task.get()->get_state();
+      if (state != WorkState::Unknown && !task.get()->is_finished()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // resets the finished tasks for the next replay, returns false if the
+  // previous replay is still running. Inputs of the next replay must only be
+  // bound once the graph is reset, Executor::run does not reset it again.
+  bool reset() {
+    if (_is_reset) {
+      return true;
+    }
+    if (is_running()) {
+      return false;
+    }
+    // a cancelled replay must not cancel the next one
+    if (_cancellation_token.is_cancelled()) {
+      _cancellation_token = CancellationToken{};
+      for (auto &task : _tasks) {
+        task.set_cancellation_token(_cancellation_token);
+      }
+    }
+    for (const auto &task : _tasks) {
+      task.get()->set_replayed();
+    }
+    _is_reset = true;
+    return true;
+  }
+
+private:
+  // all works the sink transitively depends on, including the sink
+  static std::vector<std::shared_ptr<Work>>
+  collect(const std::shared_ptr<Work> &sink) {
+    std::vector<std::shared_ptr<Work>> works = {sink};
+    std::unordered_set<Work *> visited = {sink.get()};
+    for (size_t i = 0; i < works.size(); ++i) {
+      for (const auto &predecessor : works[i]->get_predecessors()) {
+        if (visited.insert(predecessor.get()).second) {
+          works.push_back(predecessor);
+        }
+      }
+    }
+    return works;
+  }
+
+  void sort_topologically(const std::vector<std::shared_ptr<Work>> &works) {
+    std::unordered_map<Work *, size_t> indices;
+    for (size_t i = 0; i < works.size(); ++i) {
+      indices[works[i].get()] = i;
+    }
+    std::vector<size_t> nb_predecessors(works.size(), 0);
+    std::vector<std::vector<size_t>> successors(works.size());
+    for (size_t i = 0; i < works.size(); ++i) {
+      for (const auto &predecessor : works[i]->get_predecessors()) {
+        successors[indices[predecessor.get()]].push_back(i);
+        nb_predecessors[i]++;
+      }
+    }
+    std::vector<size_t> order;
+    order.reserve(works.size());
+    for (size_t i = 0; i < works.size(); ++i) {
+      if (nb_predecessors[i] == 0) {
+        order.push_back(i);
+      }
+    }
+    for (size_t i = 0; i < order.size(); ++i) {
+      for (const auto successor : successors[order[i]]) {
+        if (--nb_predecessors[successor] == 0) {
+          order.push_back(successor);
+        }
+      }
+    }
+    if (order.size() != works.size()) {
+      throw std::runtime_error("CompiledGraph: the task graph has a cycle");
+    }
+    _tasks.reserve(works.size());
+    for (const auto i : order) {
+      _tasks.emplace_back(works[i]);
+    }
+  }
+
+  void wire() {
+    std::unordered_map<Work *, std::vector<Work *>> successors;
+    for (const auto &task : _tasks) {
+      for (const auto &predecessor : task.get()->get_predecessors()) {
+        successors[predecessor.get()].push_back(task.get().get());
+      }
+    }
+    // ranked once by the longest path to the sink, which comes last
+    for (auto task = _tasks.rbegin(); task != _tasks.rend(); ++task) {
+      size_t rank = 0;
+      for (const auto *successor : successors[task->get().get()]) {
+        rank = std::max(rank, successor->get_rank() + 1);
+      }
+      task->get()->set_rank(rank);
+    }
+    for (const auto &task : _tasks) {
+      auto &work = *task.get();
+      const auto nb_predecessors = work.get_predecessors().size();
+      work.set_compiled_successors(std::move(successors[&work]),
+                                   nb_predecessors);
+      if (nb_predecessors == 0) {
+        _roots.push_back(task);
+      }
+    }
+  }
+
+  // called by the executor when it starts the replay
+  void set_started() { _is_reset = false; }
+
+  std::vector<Task> _tasks;
+  std::vector<Task> _roots;
+  CancellationToken _cancellation_token;
+  bool _is_reset = false;
+  friend class Executor;
+};
+
+} // namespace par
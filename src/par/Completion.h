@@ -0,0 +1,53 @@
+#pragma once
+
+#include "par/Task.h"
+#include "par/Work.h"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+
+namespace par {
+
+// handle on a submitted task or task graph that can be waited on, polled or
+// be given callbacks to run once it is finished
+class Completion {
+public:
+  Completion() = default;
+  Completion(const Completion &) = default;
+  Completion(Completion &&) = default;
+  Completion &operator=(const Completion &) = default;
+  Completion &operator=(Completion &&) = default;
+  virtual ~Completion() = default;
+  Completion(const Task &task) : _work{task.get()} {}
+
+  // also true if the task was cancelled
+  bool is_done() const { return !_work || _work->is_finished(); }
+  bool is_cancelled() const { return _work && _work->is_cancelled(); }
+
+  void wait() const {
+    if (_work) {
+      _work->wait_for_finished();
+    }
+  }
+
+  bool wait_for(std::chrono::microseconds timeout) const {
+    return !_work || _work->wait_for_finished(timeout);
+  }
+
+  // the callback runs on the thread finishing the task before any waiter is
+  // released, or right away if the task is already done. It must not wait
+  // on the task it is registered on.
+  void on_completion(std::function<void()> callback) const {
+    if (!_work) {
+      callback();
+      return;
+    }
+    _work->add_completion_callback(std::move(callback));
+  }
+
+private:
+  std::shared_ptr<Work> _work;
+};
+
+} // namespace par
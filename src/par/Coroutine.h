@@ -0,0 +1,281 @@
+#pragma once
+
+// awaiting par tasks from C++20 coroutines, compiled only with C++20
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+#define PAR_COROUTINES 1
+
+#include "par/Calc.h"
+#include "par/Calculation.h"
+#include "par/Completion.h"
+#include "par/Executor.h"
+#include "par/Task.h"
+#include "par/TaskGraph.h"
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace par {
+
+template <class T = void> class Async;
+
+namespace detail {
+
+// resumes the coroutine on a worker of the executor, or right away on the
+// calling thread if there is no executor
+inline void resume_on(Executor *executor, std::coroutine_handle<> handle) {
+  if (!executor) {
+    handle.resume();
+    return;
+  }
+  executor->run(make_task([handle]() { handle.resume(); }, "resume"));
+}
+
+} // namespace detail
+
+class ScheduleAwaiter {
+public:
+  ScheduleAwaiter(Executor &executor) : _executor{executor} {}
+
+  bool await_ready() const noexcept { return false; }
+  template <class Promise>
+  void await_suspend(std::coroutine_handle<Promise> handle) {
+    // later awaits of an async resume on this executor as well
+    if constexpr (requires { handle.promise().set_executor(&_executor); }) {
+      handle.promise().set_executor(&_executor);
+    }
+    detail::resume_on(&_executor, handle);
+  }
+  void await_resume() const noexcept {}
+
+private:
+  Executor &_executor;
+};
+
+inline ScheduleAwaiter Executor::schedule() { return ScheduleAwaiter{*this}; }
+
+// resumes the awaiting coroutine once the task is finished or cancelled. The
+// task is not started by awaiting it, it has to be run on an executor.
+class CompletionAwaiter {
+public:
+  CompletionAwaiter(Completion completion, Executor *executor)
+      : _completion{std::move(completion)}, _executor{executor} {}
+
+  bool await_ready() const { return _completion.is_done(); }
+  void await_suspend(std::coroutine_handle<> handle) {
+    // the callback runs while the task finishes, the coroutine continues in
+    // a task of its own so that it may wait for the task again
+    _completion.on_completion([executor = _executor, handle]() {
+      detail::resume_on(executor, handle);
+    });
+  }
+  void await_resume() const {}
+
+private:
+  Completion _completion;
+  Executor *_executor;
+};
+
+// co_await calc gives the result of the calc, move-only results are moved
+// out of it
+template <class Signature> class CalcAwaiter : public CompletionAwaiter {
+public:
+  CalcAwaiter(Calc<Signature> calc, Executor *executor)
+      : CompletionAwaiter{Completion{calc.make_task()}, executor},
+        _calc{std::move(calc)} {}
+
+  auto await_resume() {
+    if constexpr (requires { _calc.result(); }) {
+      using Result = std::decay_t<decltype(_calc.result())>;
+      if constexpr (std::is_copy_constructible_v<Result>) {
+        return Result{_calc.result()};
+      } else {
+        return _calc.take_result();
+      }
+    }
+  }
+
+private:
+  Calc<Signature> _calc;
+};
+
+namespace detail {
+
+class AsyncPromiseBase {
+public:
+  struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+    template <class Promise>
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      auto &promise = handle.promise();
+      if (promise._continuation) {
+        return promise._continuation;
+      }
+      // the async may be destroyed as soon as its completion is done, so the
+      // promise must not be used after running the completion task
+      if (promise._executor && promise._completion_task) {
+        auto task = std::move(*promise._completion_task);
+        promise._executor->run(std::move(task));
+      }
+      return std::noop_coroutine();
+    }
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() { _exception = std::current_exception(); }
+
+  void set_executor(Executor *executor) { _executor = executor; }
+  Executor *get_executor() const { return _executor; }
+  void set_continuation(std::coroutine_handle<> continuation) {
+    _continuation = continuation;
+  }
+  void set_completion_task(Task task) { _completion_task = std::move(task); }
+
+  CompletionAwaiter await_transform(Completion completion) const {
+    return CompletionAwaiter{std::move(completion), _executor};
+  }
+  CompletionAwaiter await_transform(const Task &task) const {
+    return CompletionAwaiter{Completion{task}, _executor};
+  }
+  CompletionAwaiter await_transform(const TaskGraph &task_graph) const {
+    return CompletionAwaiter{Completion{task_graph.get_tasks().front()},
+                             _executor};
+  }
+  template <class Signature>
+  CalcAwaiter<Signature> await_transform(Calc<Signature> calc) const {
+    return CalcAwaiter<Signature>{std::move(calc), _executor};
+  }
+  ScheduleAwaiter await_transform(ScheduleAwaiter awaiter) const {
+    return awaiter;
+  }
+  template <class T> auto await_transform(Async<T> &async) const {
+    return typename Async<T>::Awaiter{async};
+  }
+  template <class T> auto await_transform(Async<T> &&async) const {
+    return typename Async<T>::Awaiter{async};
+  }
+
+protected:
+  void rethrow_exception() const {
+    if (_exception) {
+      std::rethrow_exception(_exception);
+    }
+  }
+
+private:
+  Executor *_executor = nullptr;
+  std::coroutine_handle<> _continuation;
+  std::optional<Task> _completion_task;
+  std::exception_ptr _exception;
+};
+
+template <class T> class AsyncPromise : public AsyncPromiseBase {
+public:
+  Async<T> get_return_object() {
+    return Async<T>{std::coroutine_handle<AsyncPromise>::from_promise(*this)};
+  }
+  template <class U> void return_value(U &&value) {
+    _result.emplace(std::forward<U>(value));
+  }
+  T take_result() {
+    rethrow_exception();
+    return std::move(*_result);
+  }
+
+private:
+  std::optional<T> _result;
+};
+
+template <> class AsyncPromise<void> : public AsyncPromiseBase {
+public:
+  Async<void> get_return_object();
+  void return_void() const {}
+  void take_result() const { rethrow_exception(); }
+};
+
+} // namespace detail
+
+// coroutine returning T that awaits par tasks without blocking a thread.
+// The coroutine starts suspended, it is either started on an executor with
+// Executor::spawn or awaited from another async, which then resumes once it
+// is done. Tasks, task graphs, completions and calcs can be awaited inside.
+template <class T> class Async {
+public:
+  using promise_type = detail::AsyncPromise<T>;
+
+  Async() = default;
+  Async(const Async &) = delete;
+  Async(Async &&other) noexcept
+      : _handle{std::exchange(other._handle, nullptr)} {}
+  Async &operator=(const Async &) = delete;
+  Async &operator=(Async &&other) noexcept {
+    if (this != &other) {
+      destroy();
+      _handle = std::exchange(other._handle, nullptr);
+    }
+    return *this;
+  }
+  ~Async() { destroy(); }
+
+  // the value of co_return, rethrows the exception the coroutine exited with
+  T take_result() { return _handle.promise().take_result(); }
+
+  class Awaiter {
+  public:
+    Awaiter(Async &async) : _async{async} {}
+
+    bool await_ready() const noexcept { return false; }
+    template <class Promise>
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<Promise> awaiting) noexcept {
+      auto &promise = _async._handle.promise();
+      promise.set_executor(awaiting.promise().get_executor());
+      promise.set_continuation(awaiting);
+      return _async._handle;
+    }
+    T await_resume() { return _async.take_result(); }
+
+  private:
+    Async &_async;
+  };
+
+private:
+  explicit Async(std::coroutine_handle<promise_type> handle)
+      : _handle{handle} {}
+
+  void destroy() {
+    if (_handle) {
+      _handle.destroy();
+      _handle = nullptr;
+    }
+  }
+
+  std::coroutine_handle<promise_type> _handle;
+  friend promise_type;
+  friend class Executor;
+};
+
+inline Async<void> detail::AsyncPromise<void>::get_return_object() {
+  return Async<void>{
+      std::coroutine_handle<AsyncPromise>::from_promise(*this)};
+}
+
+template <class T> Completion Executor::spawn(Async<T> &async) {
+  auto &promise = async._handle.promise();
+  auto completion_task = make_task([]() {}, "async");
+  promise.set_executor(this);
+  promise.set_completion_task(completion_task);
+  detail::resume_on(this, async._handle);
+  return Completion{completion_task};
+}
+
+} // namespace par
+
+#else
+#define PAR_COROUTINES 0
+#endif
@@ -1,21 +1,56 @@
 #pragma once
 
+#include "par/Affinity.h"
+#include "par/CompiledGraph.h"
+#include "par/Completion.h"
+#include "par/MpmcQueue.h"
+#include "par/ReadyQueue.h"
 #include "par/Task.h"
 #include "par/TaskGraph.h"
+#include "par/Tracing.h"
+#include "par/WorkStealingQueue.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <iostream>
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <queue>
+#include <stdexcept>
+#include <string>
 #include <thread>
+#include <unordered_map>
+#include <utility>
 
 #define DO_LOG 0
 
 namespace par {
 
+// the global queue dispatches ready tasks earliest deadline first, work
+// stealing favours cache locality and ignores deadlines
+enum class Scheduling { GlobalQueue, WorkStealing };
+
+// a helping caller runs ready tasks of the executor until the awaited task is
+// finished, this also allows to wait from inside of a task
+enum class Waiting { Block, Help };
+
+// limits of the work admitted by Executor::try_run, 0 means no limit. A graph
+// with more tasks than max_tasks is still admitted if nothing is in flight.
+struct AdmissionLimits {
+  size_t max_graphs = 0;
+  size_t max_tasks = 0;
+};
+
+#if __cplusplus >= 202002L
+// coroutine support, defined in par/Coroutine.h
+class ScheduleAwaiter;
+template <class T> class Async;
+#endif
+
 class Executor {
 public:
   Executor() = default;
@@ -26,252 +61,610 @@ public:
     std::cout << "Executor::~Executor()" << std::endl;
 #endif
     cancel_all();
-    _main_thread.join();
+    for (auto &thread : _worker_threads) {
+      thread.join();
+    }
+    if (_timer_thread.joinable()) {
+      _timer_thread.join();
+    }
   }
 
-  Executor(int num_threads) : _mutex{std::make_shared<std::mutex>()} {
-    async_init(num_threads);
+  Executor(int num_threads, Scheduling scheduling = Scheduling::GlobalQueue,
+           Affinity affinity = Affinity{})
+      : _scheduling{scheduling}, _sync{std::make_shared<Synchronization>()} {
+    // ready tasks are pushed to the queue of a worker
+    if (scheduling == Scheduling::WorkStealing && num_threads <= 0) {
+      throw std::runtime_error("Executor: work stealing needs a worker");
+    }
+    for (int i = 0; i < num_threads; ++i) {
+      _worker_queues.push_back(std::make_shared<WorkStealingQueue>());
+    }
+#if PAR_TRACE
+    _trace_recorder = std::make_shared<TraceRecorder>(num_threads);
+#endif
+    start_workers(num_threads, affinity);
+    _timer_thread = std::thread{[this]() { execute_timer_thread(); }};
   }
 
-  void run_in(Task task, std::chrono::microseconds start_difference) {
+  Completion run_in(Task task, std::chrono::microseconds start_difference) {
 #if DO_LOG
     std::cout << "Executor::run_in()" << std::endl;
 #endif
-    std::unique_lock<std::mutex> lock(*_mutex);
-    const auto now = std::chrono::high_resolution_clock::now();
-    const auto start_time = now + start_difference;
-    _queued_tasks.push_back({task, start_time});
+    if (!task.get()->set_queued()) {
+      return Completion{task};
+    }
+#if PAR_TRACE
+    task.get()->get_trace().queued = std::chrono::high_resolution_clock::now();
+#endif
+    {
+      std::unique_lock<std::mutex> lock(_sync->timer_mutex);
+      const auto now = std::chrono::high_resolution_clock::now();
+      const auto start_time = now + start_difference;
+      _timed_tasks.push({task, start_time});
+    }
+    _sync->timer_changed.notify_one();
+    return Completion{task};
   }
 
-  void run_in(TaskGraph task_graph, std::chrono::microseconds start_difference){
+  Completion run_in(TaskGraph task_graph, std::chrono::microseconds start_difference){
+    rank_upward(task_graph);
     for(const auto& task : task_graph.get_tasks()){
       if(does_not_know(task)){
         run_in(task, start_difference);
       }
     }
+    return Completion{task_graph.get_tasks().front()};
   }
 
-  void run(Task task) {
+  Completion run(Task task) {
 #if DO_LOG
     std::cout << "Executor::run()" << std::endl;
 #endif
-    std::unique_lock<std::mutex> lock(*_mutex);
-    const auto now = std::chrono::high_resolution_clock::now();
-    _queued_tasks.push_back({task, now});
+    if (task.get()->set_queued()) {
+#if PAR_TRACE
+      task.get()->get_trace().queued =
+          std::chrono::high_resolution_clock::now();
+#endif
+      if (task.get()->get_client() == 0) {
+        task.get()->set_client(_current_client);
+      }
+      submit(task);
+    }
+    return Completion{task};
   }
 
-  void run(TaskGraph task_graph){
+  Completion run(TaskGraph task_graph){
+    rank_upward(task_graph);
     for(const auto& task : task_graph.get_tasks()){
       if(does_not_know(task)){
         run(task);
       }
     }
+    return Completion{task_graph.get_tasks().front()};
   }
 
-  bool erase_work_from_finished(Task work, bool do_lock = true) {
-    std::optional<std::unique_lock<std::mutex>> lock;
-    if (do_lock) {
-      lock = std::unique_lock<std::mutex>{*_mutex};
+  // replays the compiled graph, resetting it unless it was reset already.
+  // Throws std::runtime_error if the previous replay is still running.
+  Completion run(CompiledGraph &graph) {
+    if (!graph.reset()) {
+      throw std::runtime_error("Executor::run: compiled graph is running");
     }
-    auto it = std::find(_finished_tasks.begin(), _finished_tasks.end(), work);
-    if (it == _finished_tasks.end()) {
-      return false;
+    graph.set_started();
+#if PAR_TRACE
+    const auto now = std::chrono::high_resolution_clock::now();
+    for (const auto &task : graph.get_tasks()) {
+      task.get()->get_trace().queued = now;
     }
-    _finished_tasks.erase(
-        std::remove(_finished_tasks.begin(), _finished_tasks.end(), work),
-        _finished_tasks.end());
-    for (auto predecessor : work._work->get_predecessors()) {
-      erase_work_from_finished(Task{predecessor}, /*do_lock=*/false);
+#endif
+    for (const auto &root : graph.get_roots()) {
+      push_ready(root);
     }
-    return true;
+    return Completion{graph.get_sink()};
+  }
+
+  Completion run(Task task, TimePoint deadline) {
+    task.set_deadline(deadline);
+    return run(task);
+  }
+
+  Completion run(TaskGraph task_graph, TimePoint deadline) {
+    task_graph.set_deadline(deadline);
+    return run(task_graph);
   }
 
-  void wait_for(Task work) {
+  // the graph takes turns with the graphs of the other clients
+  Completion run(TaskGraph task_graph, ClientId client) {
+    task_graph.set_client(client);
+    return run(task_graph);
+  }
+
+  // a new client of the global queue, e.g. one per video stream sharing the
+  // executor
+  ClientId add_client() { return _sync->next_client++; }
+
+  void wait_for(Task work, Waiting waiting = Waiting::Block) {
 #if DO_LOG
     std::cout << "Executor::wait_for()" << std::endl;
 #endif
-    while (true) {
-#if DO_LOG
-      std::cout << "Executor::wait_for() checking if finished" << std::endl;
-#endif
-      if (erase_work_from_finished(work)) {
-        break;
-      }
-#if DO_LOG
-      std::cout << "Executor::wait_for() sleep 1ms" << std::endl;
-#endif
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    if (waiting == Waiting::Help) {
+      help_until_finished(work);
+    } else {
+      work.get()->wait_for_finished();
     }
 #if DO_LOG
     std::cout << "Executor::wait_for() return" << std::endl;
 #endif
   }
 
-  void wait_for(TaskGraph task_graph){
-    wait_for(task_graph.get_tasks().front());
+  void wait_for(TaskGraph task_graph, Waiting waiting = Waiting::Block) {
+    wait_for(task_graph.get_tasks().front(), waiting);
   }
 
   bool wait_for(Task work, std::chrono::microseconds timeout) {
 #if DO_LOG
     std::cout << "Executor::wait_for(timeout)" << std::endl;
 #endif
-    auto start = std::chrono::high_resolution_clock::now();
-    while (true) {
-#if DO_LOG
-      std::cout << "Executor::wait_for(timeout) checking if finished"
-                << std::endl;
-#endif
-      if (erase_work_from_finished(work)) {
-        return true;
-      }
-      auto now = std::chrono::high_resolution_clock::now();
-      if (now - start > timeout) {
-        return false;
-      }
-      std::this_thread::sleep_for(std::chrono::microseconds(1));
-    }
-    // should never be reached
-    return false;
+    return work.get()->wait_for_finished(timeout);
   }
 
   bool wait_for(TaskGraph task_graph, std::chrono::microseconds timeout){
     return wait_for(task_graph.get_tasks().front(), timeout);
   }
 
+  // applies to work admitted from now on
+  void set_admission_limits(AdmissionLimits limits) {
+    std::unique_lock<std::mutex> lock(_sync->admission_mutex);
+    _sync->admission_limits = limits;
+    _sync->admission_changed.notify_all();
+  }
+
+  // admits a graph of nb_tasks tasks if the admission limits allow it, waits
+  // up to timeout for in-flight work to finish otherwise. Admitted work has to
+  // be released with release_on.
+  bool try_admit(size_t nb_tasks, std::chrono::microseconds timeout =
+                                      std::chrono::microseconds{0}) {
+    std::unique_lock<std::mutex> lock(_sync->admission_mutex);
+    const auto is_admissible = [this, nb_tasks]() {
+      const auto &limits = _sync->admission_limits;
+      const auto nb_graphs = _sync->nb_graphs_in_flight;
+      const auto nb_tasks_in_flight = _sync->nb_tasks_in_flight;
+      return _sync->cancelled ||
+             ((limits.max_graphs == 0 || nb_graphs < limits.max_graphs) &&
+              (limits.max_tasks == 0 || nb_graphs == 0 ||
+               nb_tasks_in_flight + nb_tasks <= limits.max_tasks));
+    };
+    if (!_sync->admission_changed.wait_for(lock, timeout, is_admissible) ||
+        _sync->cancelled) {
+      return false;
+    }
+    _sync->nb_graphs_in_flight++;
+    _sync->nb_tasks_in_flight += nb_tasks;
+    return true;
+  }
+
+  // gives admitted work back once it is completed or cancelled
+  void release_on(const Completion &completion, size_t nb_tasks) {
+    completion.on_completion([sync = _sync, nb_tasks]() {
+      {
+        std::unique_lock<std::mutex> lock(sync->admission_mutex);
+        sync->nb_graphs_in_flight--;
+        sync->nb_tasks_in_flight -= nb_tasks;
+      }
+      sync->admission_changed.notify_all();
+    });
+  }
+
+  // runs the task graph if it is admitted within the timeout, the caller may
+  // drop the graph or try again otherwise
+  std::optional<Completion>
+  try_run(TaskGraph task_graph,
+          std::chrono::microseconds timeout = std::chrono::microseconds{0}) {
+    const auto nb_tasks = task_graph.get_tasks().size();
+    if (!try_admit(nb_tasks, timeout)) {
+      return std::nullopt;
+    }
+    auto completion = run(task_graph);
+    release_on(completion, nb_tasks);
+    return completion;
+  }
+
+  std::optional<Completion>
+  try_run(Task task,
+          std::chrono::microseconds timeout = std::chrono::microseconds{0}) {
+    if (!try_admit(1, timeout)) {
+      return std::nullopt;
+    }
+    auto completion = run(task);
+    release_on(completion, 1);
+    return completion;
+  }
+
+  size_t get_nb_graphs_in_flight() const {
+    std::unique_lock<std::mutex> lock(_sync->admission_mutex);
+    return _sync->nb_graphs_in_flight;
+  }
+
+#if __cplusplus >= 202002L
+  // co_await executor.schedule() resumes the coroutine on a worker
+  ScheduleAwaiter schedule();
+  // starts the coroutine on a worker, the async must outlive the completion
+  template <class T> Completion spawn(Async<T> &async);
+#endif
+
+  // the core each worker is pinned to, -1 for workers that are not pinned
+  const std::vector<int> &get_worker_cores() const { return _worker_cores; }
+
   bool does_not_know(Task work) {
-    std::unique_lock<std::mutex> lock(*_mutex);
-    bool not_in_queued_tasks =
-        std::find_if(_queued_tasks.begin(), _queued_tasks.end(),
-                     [&work](const auto &timed_task) {
-                       return timed_task.task == work;
-                     }) == _queued_tasks.end();
-    bool not_in_scheduled_tasks =
-        std::find(_scheduled_tasks.begin(), _scheduled_tasks.end(), work) ==
-        _scheduled_tasks.end();
-    bool not_in_started_tasks =
-        std::find(_started_tasks.begin(), _started_tasks.end(), work) ==
-        _started_tasks.end();
-    bool not_in_finished_tasks =
-        std::find(_finished_tasks.begin(), _finished_tasks.end(), work) ==
-        _finished_tasks.end();
-    return not_in_queued_tasks && not_in_scheduled_tasks &&
-           not_in_started_tasks && not_in_finished_tasks;
+    return work.get()->get_state() == WorkState::Unknown;
+  }
+
+  // writes the tasks finished so far as chrome trace event json, returns
+  // false if tracing is compiled out, the executor was default constructed or
+  // moved from, or the file cannot be written
+  bool write_trace([[maybe_unused]] const std::string &path) const {
+#if PAR_TRACE
+    return _trace_recorder && _trace_recorder->write_chrome_trace(path);
+#else
+    return false;
+#endif
   }
 
 private:
-  void async_init(size_t num_threads) {
+  void start_workers(size_t num_threads, const Affinity &affinity) {
 #if DO_LOG
-    std::cout << "Executor::async_init()" << std::endl;
+    std::cout << "Executor::start_workers()" << std::endl;
 #endif
-    _main_thread = std::thread{[this, num_threads]() {
-      for (size_t i = 0; i < num_threads; ++i) {
-        _worker_threads.emplace_back([this]() { execute_worker_thread(); });
+    for (size_t i = 0; i < num_threads; ++i) {
+      _worker_threads.emplace_back([this, i]() { execute_worker_thread(i); });
+      const auto core = affinity.core_of_worker(i);
+      const auto is_pinned = core >= 0 && pin_thread(_worker_threads[i], core);
+      _worker_cores.push_back(is_pinned ? core : -1);
+    }
+  }
+
+  // ranks the tasks of the graph not submitted yet by the longest path to its
+  // sink, so that the critical path of the graph is dispatched first
+  void rank_upward(const TaskGraph &task_graph) {
+    const auto &tasks = task_graph.get_tasks();
+    std::unordered_map<Work *, size_t> indices;
+    indices.reserve(tasks.size());
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      indices[tasks[i].get().get()] = i;
+    }
+    // visits a task once all its successors within the graph are ranked,
+    // starting at the sink
+    std::vector<size_t> nb_unranked_successors(tasks.size(), 0);
+    for (const auto &task : tasks) {
+      for (const auto &predecessor : task.get()->get_predecessors()) {
+        const auto index = indices.find(predecessor.get());
+        if (index != indices.end()) {
+          nb_unranked_successors[index->second]++;
+        }
       }
-      for (auto &thread : _worker_threads) {
-        thread.join();
+    }
+    std::vector<size_t> ranks(tasks.size(), 0);
+    std::vector<size_t> order = {0};
+    order.reserve(tasks.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      const auto &work = *tasks[order[i]].get();
+      for (const auto &predecessor : work.get_predecessors()) {
+        const auto index = indices.find(predecessor.get());
+        if (index == indices.end()) {
+          continue;
+        }
+        auto &rank = ranks[index->second];
+        rank = std::max(rank, ranks[order[i]] + 1);
+        if (--nb_unranked_successors[index->second] == 0) {
+          order.push_back(index->second);
+        }
       }
-    }};
+    }
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      if (does_not_know(tasks[i])) {
+        tasks[i].get()->set_rank(ranks[i]);
+      }
+    }
   }
 
-  void execute_worker_thread() {
+  void execute_worker_thread(size_t worker_index) {
     for (;;) {
-      bool shall_I_cancel = false;
-      {
-        std::unique_lock<std::mutex> lock(*_mutex);
-        shall_I_cancel = _cancelled;
+      const auto epoch = _sync->epoch.load();
+      auto work = pop_task(worker_index);
+      if (!work) {
+        if (!wait_for_work(epoch)) {
 #if DO_LOG
-        std::cout << "Executor::execute_worker_thread() shall I cancel?"
-                  << std::endl;
+          std::cout << "Executor::execute_worker_thread() do cancel?"
+                    << std::endl;
 #endif
+          break;
+        }
+        continue;
       }
-      if (shall_I_cancel) {
 #if DO_LOG
-        std::cout << "Executor::execute_worker_thread() do cancel?"
-                  << std::endl;
+      std::cout << "Executor::execute_worker_thread() do_work" << std::endl;
 #endif
-        break;
-      }
-      schedule_task();
-      auto work = pop_task();
-      if (!work) {
+      execute(*work, worker_index);
 #if DO_LOG
-        std::cout << "Executor::execute_worker_thread() sleep 1ms" << std::endl;
+      std::cout << "Executor::execute_worker_thread() finished_work"
+                << std::endl;
 #endif
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-      } else {
-#if DO_LOG
-        std::cout << "Executor::execute_worker_thread() do_work" << std::endl;
+    }
+  }
+
+  // the caller takes the place of one of the workers and shares its queue
+  void help_until_finished(const Task &work) {
+    if (_worker_queues.empty()) {
+      work.get()->wait_for_finished();
+      return;
+    }
+    const auto worker_index = _sync->next_queue++ % _worker_queues.size();
+    while (!work.get()->is_finished()) {
+      auto task = pop_task(worker_index);
+      if (!task) {
+        // tasks becoming ready are picked up after the poll interval at the
+        // latest
+        work.get()->wait_for_finished(_help_poll_interval);
+        continue;
+      }
+      execute(*task, worker_index);
+    }
+    // a successor the caller would have picked up itself is left to a worker
+    signal_work_available();
+  }
+
+  void execute(const Task &work, size_t worker_index) {
+    // cancelled works are not called but still release their successors
+    const auto is_cancelled = work.get()->is_cancellation_requested();
+    // tasks run by the work or its completion callbacks belong to its client,
+    // a helping caller gets its own client back afterwards
+    const auto previous_client =
+        std::exchange(_current_client, work.get()->get_client());
+    if (!is_cancelled) {
+#if PAR_TRACE
+      auto &trace = work.get()->get_trace();
+      trace.worker = worker_index;
+      trace.started = std::chrono::high_resolution_clock::now();
 #endif
-        work->get()->call();
-        work->get()->set_finished();
-#if DO_LOG
-        std::cout << "Executor::execute_worker_thread() finished_work"
-                  << std::endl;
+      work.get()->call();
+#if PAR_TRACE
+      trace.finished = std::chrono::high_resolution_clock::now();
+      _trace_recorder->record(trace);
 #endif
-        std::unique_lock<std::mutex> lock(*_mutex);
-        _started_tasks.erase(
-            std::remove(_started_tasks.begin(), _started_tasks.end(), *work),
-            _started_tasks.end());
+    }
+    finish_task(work, worker_index, is_cancelled);
+    _current_client = previous_client;
+  }
+
+  void finish_task(const Task &work, size_t worker_index, bool is_cancelled) {
+    std::vector<Task> ready_tasks;
+    for (auto &successor : work.get()->set_finished(is_cancelled)) {
+      ready_tasks.emplace_back(std::move(successor));
+    }
+    // successors made ready by this task are handed to the finishing worker
+    dispatch(std::move(ready_tasks), worker_index);
+  }
+
+  // spins for a short while and then parks the worker until new work may be
+  // ready or the executor gets cancelled
+  bool wait_for_work(size_t epoch) {
+    for (size_t i = 0; i < _nb_spins; ++i) {
+      if (_sync->epoch.load() != epoch) {
+        return true;
+      }
+      std::this_thread::yield();
+    }
 #if DO_LOG
-        std::cout << "Executor::execute_worker_thread() removing finished work"
-                  << std::endl;
+    std::cout << "Executor::wait_for_work() park" << std::endl;
 #endif
-        _finished_tasks.push_back(*work);
-      }
+    std::unique_lock<std::mutex> lock(_sync->mutex);
+    _sync->nb_parked++;
+    const auto woken = [this, epoch]() {
+      return _sync->cancelled || _sync->epoch.load() != epoch;
+    };
+    _sync->work_available.wait(lock, woken);
+    _sync->nb_parked--;
+    return !_sync->cancelled;
+  }
+
+  // must be called without the lock held
+  void signal_work_available(size_t nb_workers = 1) {
+    _sync->epoch++;
+    if (_sync->nb_parked == 0) {
+      return;
+    }
+    // a worker that is about to park holds the lock while checking the epoch
+    { std::unique_lock<std::mutex> lock(_sync->mutex); }
+    for (size_t i = 0; i < nb_workers; ++i) {
+      _sync->work_available.notify_one();
     }
   }
 
-  void schedule_task() {
-#if DO_LOG
-    std::cout << "Executor::schedule_task() size: " << _queued_tasks.size()
-              << std::endl;
+  void submit(const Task &task) {
+    if (!task.get()->link_to_predecessors()) {
+      return;
+    }
+    push_ready(task);
+  }
+
+  void push_ready(Task task) {
+    task.get()->set_ready();
+#if PAR_TRACE
+    task.get()->get_trace().ready = std::chrono::high_resolution_clock::now();
 #endif
-    std::unique_lock<std::mutex> lock(*_mutex);
+    // submissions do not take a lock unless the submission queue is full
+    if (!_sync->submissions.try_push(std::move(task))) {
+      if (_scheduling == Scheduling::WorkStealing) {
+        const auto queue_index = _sync->next_queue++ % _worker_queues.size();
+        _worker_queues[queue_index]->push(std::move(task));
+      } else {
+        std::unique_lock<std::mutex> lock(_sync->mutex);
+        push_scheduled(std::move(task));
+      }
+    }
+    signal_work_available();
+  }
+
+  // submits the delayed tasks as soon as their start time has come
+  void execute_timer_thread() {
+    std::unique_lock<std::mutex> lock(_sync->timer_mutex);
+    while (!_sync->cancelled) {
+      if (_timed_tasks.empty()) {
+        _sync->timer_changed.wait(lock);
+        continue;
+      }
+      const auto start_time = _timed_tasks.top().start_time;
+      if (std::chrono::high_resolution_clock::now() < start_time) {
+        _sync->timer_changed.wait_until(lock, start_time);
+        continue;
+      }
+      const auto task = _timed_tasks.top().task;
+      _timed_tasks.pop();
+      lock.unlock();
+      submit(task);
+      lock.lock();
+    }
+  }
+
+  void dispatch(std::vector<Task> ready_tasks, size_t worker_index) {
+    if (ready_tasks.empty()) {
+      return;
+    }
+#if PAR_TRACE
     const auto now = std::chrono::high_resolution_clock::now();
-    auto queued_tasks_iterator = _queued_tasks.begin();
-    while (queued_tasks_iterator != _queued_tasks.end()) {
-      if (queued_tasks_iterator->start_time < now &&
-          queued_tasks_iterator->task.get()->can_be_started()) {
-        _scheduled_tasks.insert(_scheduled_tasks.begin(),
-                                queued_tasks_iterator->task);
-        queued_tasks_iterator = _queued_tasks.erase(queued_tasks_iterator);
-      } else
-        queued_tasks_iterator++;
+    for (const auto &task : ready_tasks) {
+      task.get()->get_trace().ready = now;
+    }
+#endif
+    if (_scheduling == Scheduling::WorkStealing) {
+      for (auto &task : ready_tasks) {
+        task.get()->set_ready();
+        _worker_queues[worker_index]->push(std::move(task));
+      }
+    } else {
+      std::unique_lock<std::mutex> lock(_sync->mutex);
+      for (auto &task : ready_tasks) {
+        task.get()->set_ready();
+        push_scheduled(std::move(task));
+      }
+    }
+    // the calling worker picks up one of the ready tasks itself
+    if (ready_tasks.size() > 1) {
+      signal_work_available(ready_tasks.size() - 1);
     }
   }
 
-  std::optional<Task> pop_task() {
+  // must be called with the lock held
+  void push_scheduled(Task task) {
+    const auto &work = *task.get();
+    const auto deadline = work.get_deadline();
+    const auto rank = work.get_rank();
+    const auto client = work.get_client();
+    _scheduled_tasks.push(std::move(task), deadline, rank, client);
+  }
+
+  std::optional<Task> pop_task(size_t worker_index) {
 #if DO_LOG
     std::cout << "Executor::pop_task()" << std::endl;
 #endif
-    std::unique_lock<std::mutex> lock(*_mutex);
-    if (_scheduled_tasks.empty()) {
+    if (_sync->cancelled) {
       return std::nullopt;
     }
-    auto work = _scheduled_tasks.back();
-    _scheduled_tasks.pop_back();
-    _started_tasks.push_back(work);
+    std::optional<Task> work;
+    if (_scheduling == Scheduling::WorkStealing) {
+      work = _worker_queues[worker_index]->pop();
+      if (!work) {
+        work = _sync->submissions.try_pop();
+      }
+      for (size_t i = 1; !work && i < _worker_queues.size(); ++i) {
+        work = _worker_queues[(worker_index + i) % _worker_queues.size()]
+                   ->steal();
+      }
+    } else {
+      std::unique_lock<std::mutex> lock(_sync->mutex);
+      // submissions are ordered by their deadline together with the tasks
+      // made ready by the workers
+      while (auto submitted = _sync->submissions.try_pop()) {
+        push_scheduled(std::move(*submitted));
+      }
+      work = _scheduled_tasks.pop(std::chrono::high_resolution_clock::now());
+    }
+    if (work) {
+      work->get()->set_running();
+    }
     return work;
   }
 
   void cancel_all() {
-    std::unique_lock<std::mutex> lock(*_mutex);
-    _cancelled = true;
+    _sync->cancelled = true;
+    {
+      std::unique_lock<std::mutex> lock(_sync->mutex);
+      _sync->work_available.notify_all();
+    }
+    {
+      std::unique_lock<std::mutex> lock(_sync->admission_mutex);
+      _sync->admission_changed.notify_all();
+    }
+    std::unique_lock<std::mutex> lock(_sync->timer_mutex);
+    _sync->timer_changed.notify_all();
   }
 
   struct TimedTask {
     Task task;
     std::chrono::high_resolution_clock::time_point start_time;
+
+    bool operator>(const TimedTask &other) const {
+      return start_time > other.start_time;
+    }
   };
 
-  std::thread _main_thread;
+  // state shared between the workers, kept behind a pointer so that the
+  // executor stays movable
+  struct Synchronization {
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::mutex timer_mutex;
+    std::condition_variable timer_changed;
+    std::atomic<size_t> epoch = 0;
+    std::atomic<size_t> nb_parked = 0;
+    std::atomic<size_t> next_queue = 0;
+    std::atomic<ClientId> next_client = 1;
+    std::atomic<bool> cancelled = false;
+    // tasks made ready outside of the workers, e.g. by Executor::run
+    MpmcQueue<Task> submissions{_submission_capacity};
+    std::mutex admission_mutex;
+    std::condition_variable admission_changed;
+    AdmissionLimits admission_limits;
+    size_t nb_graphs_in_flight = 0;
+    size_t nb_tasks_in_flight = 0;
+  };
+
+  std::thread _timer_thread;
   std::vector<std::thread> _worker_threads;
-  std::vector<TimedTask> _queued_tasks;
-  std::vector<Task> _scheduled_tasks;
-  std::vector<Task> _started_tasks;
-  std::vector<Task> _finished_tasks;
-  bool _cancelled = false;
-  std::shared_ptr<std::mutex> _mutex = std::make_shared<std::mutex>();
+  std::vector<int> _worker_cores;
+  std::priority_queue<TimedTask, std::vector<TimedTask>,
+                      std::greater<TimedTask>>
+      _timed_tasks;
+  FairReadyQueue _scheduled_tasks;
+  std::vector<std::shared_ptr<WorkStealingQueue>> _worker_queues;
+  Scheduling _scheduling = Scheduling::GlobalQueue;
+#if PAR_TRACE
+  std::shared_ptr<TraceRecorder> _trace_recorder;
+#endif
+  std::shared_ptr<Synchronization> _sync = std::make_shared<Synchronization>();
+  static constexpr size_t _nb_spins = 64;
+  static constexpr size_t _submission_capacity = 1024;
+  static constexpr std::chrono::microseconds _help_poll_interval{100};
+  // the client of the task running on this thread
+  static inline thread_local ClientId _current_client = 0;
 };
 
-} // namespace par
\ No newline at end of file
+// one executor with a worker per core for the whole process, shared by
+// clients that would otherwise oversubscribe the cores with executors of
+// their own
+inline std::shared_ptr<Executor> get_shared_executor() {
+  static const auto executor = std::make_shared<Executor>(
+      static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u)));
+  return executor;
+}
+
+} // namespace par
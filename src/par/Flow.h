@@ -6,6 +6,8 @@
 
 
 #include <memory>
+#include <tuple>
+#include <utility>
 
 namespace par {
 
@@ -14,8 +16,8 @@ class Task;
 class FlowImpl : public Work {
 public:
   FlowImpl() : Work{}, _work{} {}
-  FlowImpl(FlowImpl &&) = default;
-  FlowImpl &operator=(FlowImpl &&) = default;
+  FlowImpl(FlowImpl &&) = delete;
+  FlowImpl &operator=(FlowImpl &&) = delete;
   virtual ~FlowImpl() = default;
 
   void add(const Calculation &work) { _work.push_back(work.get()); }
@@ -37,6 +39,11 @@ private:
 class Flow {
 public:
   Flow() : _impl{std::make_shared<FlowImpl>()} {}
+  // the label names the task in traces recorded with PAR_TRACE enabled
+  Flow(const char *label, const std::shared_ptr<TaskArena> &arena = nullptr)
+      : _impl{make_shared_in<FlowImpl>(arena)} {
+    _impl->set_label(label);
+  }
   Flow(Flow &&) = default;
   Flow &operator=(Flow &&) = default;
   virtual ~Flow() = default;
@@ -50,5 +57,29 @@ private:
   std::shared_ptr<FlowImpl> _impl;
 };
 
+// a flow whose stages are known at compile time. The stages are fused into a
+// single callable, which calls them in order with the same arguments, so the
+// compiler can inline across them and no step goes through a virtual call.
+template <class... Stages> class StaticFlow {
+public:
+  StaticFlow(Stages... stages) : _stages{std::move(stages)...} {}
+
+  template <class... Args> void operator()(Args &&...args) {
+    std::apply([&](auto &...stages) { (stages(args...), ...); }, _stages);
+  }
+  template <class... Args> void operator()(Args &&...args) const {
+    std::apply([&](const auto &...stages) { (stages(args...), ...); },
+               _stages);
+  }
+
+  Task make_task(const char *label = nullptr,
+                 const std::shared_ptr<TaskArena> &arena = nullptr) const {
+    return par::make_task(*this, label, arena);
+  }
+
+private:
+  std::tuple<Stages...> _stages;
+};
+
 
 } // namespace par
\ No newline at end of file
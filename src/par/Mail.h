@@ -1,62 +1,173 @@
 #pragma once
 
 #include "Calc.h"
+#include "Calculation.h"
 #include "Executor.h"
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 namespace par {
 
 struct Addressee {
   virtual void receive() = 0;
+  // receives nb_messages coalesced messages at once, by default like a
+  // single message
+  virtual void receive_batch([[maybe_unused]] size_t nb_messages) {
+    receive();
+  }
   void set_inactive() { _inactive = true; }
   bool get_inactive() const { return _inactive; }
 
 private:
-  bool _inactive = false;
+  std::atomic<bool> _inactive = false;
+};
+
+// how a mail box with an executor notifies its addressees
+enum class Delivery {
+  // one task per addressee and message
+  PerMessage,
+  // all messages arrived since the last delivery are delivered at once, in
+  // one task per addressee. Messages arriving before the delivery starts are
+  // coalesced, those arriving during it wait for the next one
+  Batched
 };
 
+// copies of a mail box share their addressees
 struct MailBox {
-  MailBox(std::shared_ptr<Executor> executor) : _executor{executor} {}
+  MailBox(std::shared_ptr<Executor> executor,
+          Delivery delivery = Delivery::PerMessage)
+      : _executor{executor}, _delivery{delivery} {}
   MailBox() = default;
   MailBox(MailBox &&) = default;
   MailBox &operator=(MailBox &&) = default;
   MailBox(const MailBox &) = default;
   MailBox &operator=(const MailBox &) = default;
   void arrived() {
-    // remove deleted Orchestrators
-    auto it = std::remove_if(_addressees.begin(), _addressees.end(),
-                             [](const std::shared_ptr<Addressee> &addressee) {
-                               return addressee->get_inactive();
-                             });
-    _addressees = {_addressees.begin(), it};
-
     // synchronous updates
     if (!_executor) {
-      for (auto &addressee : _addressees) {
-        addressee->receive();
+      _state->deliver(1);
+      return;
+    }
+    if (_delivery == Delivery::Batched) {
+      // only the first message that has not been delivered yet schedules a
+      // delivery, so at most one is pending
+      if (_state->nb_pending++ == 0) {
+        schedule_delivery(_state, *_executor);
       }
       return;
     }
     // asynchronous updates
-    for (auto &addressee : _addressees) {
-      const auto func = [addressee]() {
-        if (addressee->get_inactive()) {
-          return;
-        }
-        addressee->receive();
-      };
+    for (auto &addressee : _state->collect()) {
+      const auto func = [addressee]() { deliver_to(*addressee, 1); };
       const auto calc = Calc<void()>{func};
       _executor->run(calc.make_task());
     }
   }
+  // lock-free, may be called while messages arrive
   void add(std::shared_ptr<Addressee> addressee) {
-    _addressees.push_back(addressee);
+    auto *registration =
+        new Registration{std::move(addressee), _state->registered.load()};
+    while (!_state->registered.compare_exchange_weak(registration->next,
+                                                     registration)) {
+    }
   }
 
 private:
-  std::vector<std::shared_ptr<Addressee>> _addressees;
+  struct Registration {
+    std::shared_ptr<Addressee> addressee;
+    Registration *next = nullptr;
+  };
+
+  struct State {
+    State() = default;
+    State(const State &) = delete;
+    State(State &&) = delete;
+    State &operator=(const State &) = delete;
+    State &operator=(State &&) = delete;
+    ~State() { take_registrations(); }
+
+    // moves new registrations to the addressees, drops the inactive ones and
+    // returns a snapshot of the others, messages may arrive on any thread
+    std::vector<std::shared_ptr<Addressee>> collect() {
+      const auto lock = std::lock_guard{collect_mutex};
+      auto new_addressees = take_registrations();
+      // registrations are stacked, the addressees keep their order
+      addressees.insert(addressees.end(), new_addressees.rbegin(),
+                        new_addressees.rend());
+      addressees.erase(
+          std::remove_if(addressees.begin(), addressees.end(),
+                         [](const std::shared_ptr<Addressee> &addressee) {
+                           return addressee->get_inactive();
+                         }),
+          addressees.end());
+      return addressees;
+    }
+
+    void deliver(size_t nb_messages) {
+      for (auto &addressee : collect()) {
+        deliver_to(*addressee, nb_messages);
+      }
+    }
+
+    std::vector<std::shared_ptr<Addressee>> take_registrations() {
+      std::vector<std::shared_ptr<Addressee>> taken;
+      auto *registration = registered.exchange(nullptr);
+      while (registration) {
+        taken.push_back(std::move(registration->addressee));
+        delete std::exchange(registration, registration->next);
+      }
+      return taken;
+    }
+
+    std::atomic<Registration *> registered = nullptr;
+    std::mutex collect_mutex;
+    std::vector<std::shared_ptr<Addressee>> addressees;
+    std::atomic<size_t> nb_pending = 0;
+  };
+
+  static void deliver_to(Addressee &addressee, size_t nb_messages) {
+    if (addressee.get_inactive()) {
+      return;
+    }
+    if (nb_messages == 1) {
+      addressee.receive();
+    } else {
+      addressee.receive_batch(nb_messages);
+    }
+  }
+
+  // the tasks must not own the executor, it would be destroyed on a worker
+  static void schedule_delivery(std::shared_ptr<State> state,
+                                Executor &executor) {
+    auto deliver = [state = std::move(state), &executor]() {
+      const auto nb_messages = state->nb_pending.load();
+      auto task_graph = TaskGraph{};
+      for (auto &addressee : state->collect()) {
+        const auto func = [addressee = std::move(addressee), nb_messages]() {
+          deliver_to(*addressee, nb_messages);
+        };
+        task_graph.add_task(make_task(func, "mail delivery"));
+      }
+      // an addressee gets the next batch only once it received this one, the
+      // messages arrived meanwhile get a delivery of their own
+      const auto on_delivered = [state, &executor, nb_messages]() {
+        if (state->nb_pending.fetch_sub(nb_messages) != nb_messages) {
+          schedule_delivery(state, executor);
+        }
+      };
+      executor.run(std::move(task_graph)).on_completion(on_delivered);
+    };
+    executor.run(make_task(std::move(deliver), "mail delivery"));
+  }
+
+  std::shared_ptr<State> _state = std::make_shared<State>();
   std::shared_ptr<Executor> _executor = nullptr;
+  Delivery _delivery = Delivery::PerMessage;
 };
 
 struct Orchestrator {
@@ -81,4 +192,4 @@ private:
   std::shared_ptr<Addressee> _addressee = nullptr;
 };
 
-} // namespace par
\ No newline at end of file
+} // namespace par
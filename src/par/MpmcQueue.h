@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace par {
+
+// bounded lock-free multi producer multi consumer queue after Dmitry Vyukov.
+// Every cell carries a sequence number telling producers and consumers whose
+// turn it is, so neither side ever takes a lock.
+template <class T> class MpmcQueue {
+public:
+  MpmcQueue(const MpmcQueue &) = delete;
+  MpmcQueue(MpmcQueue &&) = delete;
+  MpmcQueue &operator=(const MpmcQueue &) = delete;
+  MpmcQueue &operator=(MpmcQueue &&) = delete;
+  ~MpmcQueue() = default;
+
+  // the capacity is rounded up to a power of two
+  MpmcQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+      size *= 2;
+    }
+    _cells = std::make_unique<Cell[]>(size);
+    _mask = size - 1;
+    for (size_t i = 0; i < size; ++i) {
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  size_t capacity() const { return _mask + 1; }
+
+  // returns false if the queue is full, the value is only moved from if it
+  // was pushed
+  bool try_push(T &&value) {
+    auto position = _enqueue_position.load(std::memory_order_relaxed);
+    for (;;) {
+      auto &cell = _cells[position & _mask];
+      const auto sequence = cell.sequence.load(std::memory_order_acquire);
+      const auto difference = static_cast<std::ptrdiff_t>(sequence) -
+                              static_cast<std::ptrdiff_t>(position);
+      if (difference == 0) {
+        if (_enqueue_position.compare_exchange_weak(
+                position, position + 1, std::memory_order_relaxed)) {
+          cell.value = std::move(value);
+          cell.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = _enqueue_position.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  std::optional<T> try_pop() {
+    auto position = _dequeue_position.load(std::memory_order_relaxed);
+    for (;;) {
+      auto &cell = _cells[position & _mask];
+      const auto sequence = cell.sequence.load(std::memory_order_acquire);
+      const auto difference = static_cast<std::ptrdiff_t>(sequence) -
+                              static_cast<std::ptrdiff_t>(position + 1);
+      if (difference == 0) {
+        if (_dequeue_position.compare_exchange_weak(
+                position, position + 1, std::memory_order_relaxed)) {
+          auto value = std::optional<T>{std::move(cell.value)};
+          // the moved from value must not keep anything alive
+          cell.value = T{};
+          cell.sequence.store(position + _mask + 1, std::memory_order_release);
+          return value;
+        }
+      } else if (difference < 0) {
+        return std::nullopt;
+      } else {
+        position = _dequeue_position.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+private:
+  // a cell per cache line, neighbouring cells are used by different threads
+  struct alignas(64) Cell {
+    std::atomic<size_t> sequence = 0;
+    T value;
+  };
+
+  std::unique_ptr<Cell[]> _cells;
+  size_t _mask = 0;
+  alignas(64) std::atomic<size_t> _enqueue_position = 0;
+  alignas(64) std::atomic<size_t> _dequeue_position = 0;
+};
+
+} // namespace par
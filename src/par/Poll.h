@@ -1,13 +1,19 @@
 #pragma once
 
 #include "Calc.h"
+#include "Completion.h"
 #include "Executor.h"
 #include "Task.h"
 
-#include <chrono>
+#include <functional>
+#include <type_traits>
+#include <utility>
 
 namespace par {
 
+// runs func_to_continue with the result of calc_to_wait_for. The continuation
+// is enqueued once, by a completion hook of the awaited calc, instead of
+// polling the calc until it is finished.
 template <typename TResultWait, typename TResultContinue> struct Poll {
   Poll() = default;
   Poll(const Poll &) = default;
@@ -17,32 +23,41 @@ template <typename TResultWait, typename TResultContinue> struct Poll {
 
   Poll(Executor &executor, Calc<TResultWait()> calc_to_wait_for,
        std::function<TResultContinue(TResultWait)> func_to_continue)
-      : _executor{executor}, _calc_to_wait_for{calc_to_wait_for},
-        _func_to_continue{func_to_continue} {
-    _executor.run(_calc_to_wait_for.make_task());
+      : _calc_to_wait_for{calc_to_wait_for},
+        _calc_to_continue{[calc_to_wait_for,
+                           func = std::move(func_to_continue)]() {
+          // a copy leaves the result to other users of the calc
+          if constexpr (std::is_copy_constructible_v<TResultWait>) {
+            return func(calc_to_wait_for.result());
+          } else {
+            return func(calc_to_wait_for.take_result());
+          }
+        }} {
+    // registered before the calc runs, a calc that is already done calls
+    // the hook right away
+    Completion{_calc_to_wait_for.make_task()}.on_completion(
+        [&executor, calc_to_continue = _calc_to_continue]() {
+          executor.run(calc_to_continue.make_task());
+        });
+    const auto task_to_wait_for = _calc_to_wait_for.make_task();
+    if (executor.does_not_know(task_to_wait_for)) {
+      executor.run(task_to_wait_for);
+    }
   }
 
-  Task make_task() const {
-    return Calc<void()>([this] { poll(); }).make_task();
+  // done once the continuation has run, the poll runs the continuation itself
+  Completion completion() const {
+    return Completion{_calc_to_continue.make_task()};
   }
 
-  void poll() const {
-    if (!_executor.wait_for(_calc_to_wait_for.make_task(),
-                            std::chrono::microseconds{0})) {
-      auto this_task = make_task();
-      _executor.run_in(this_task, _timeout);
-      return;
-    }
-    auto calc_to_continue = Calc<TResultContinue()>(
-        [this]() { return _func_to_continue(_calc_to_wait_for.result()); });
-    _executor.run(calc_to_continue.make_task());
+  // the result of the continuation, valid once the completion is done
+  template <typename T = TResultContinue> const T &result() const {
+    return _calc_to_continue.result();
   }
 
 private:
-  Executor &_executor;
   Calc<TResultWait()> _calc_to_wait_for;
-  std::function<TResultContinue(TResultWait)> _func_to_continue;
-  std::chrono::microseconds _timeout{50};
+  Calc<TResultContinue()> _calc_to_continue;
 };
 
-} // namespace par
\ No newline at end of file
+} // namespace par
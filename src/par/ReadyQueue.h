@@ -0,0 +1,123 @@
+#pragma once
+
+#include "par/Task.h"
+#include "par/Work.h"
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace par {
+
+// ready tasks ordered earliest deadline first. Tasks whose deadline has
+// already passed belong to stale work and are dispatched after all tasks that
+// can still meet their deadline, but before tasks without any deadline.
+// Among tasks with equal deadlines the ones with the highest upward rank, i.e.
+// on the longest path to the sink of their graph, are dispatched first and
+// tasks of equal rank in submission order.
+class ReadyQueue {
+public:
+  void push(Task task, TimePoint deadline, size_t rank = 0) {
+    _tasks.push_back({deadline, rank, _sequence++, std::move(task)});
+    std::push_heap(_tasks.begin(), _tasks.end(), std::greater<Entry>{});
+  }
+
+  std::optional<Task> pop(TimePoint now) {
+    while (!_tasks.empty() && _tasks.front().deadline < now) {
+      _expired_tasks.push_back(pop_top());
+    }
+    if (!_tasks.empty() && _tasks.front().deadline != TimePoint::max()) {
+      return pop_top();
+    }
+    if (!_expired_tasks.empty()) {
+      auto task = std::move(_expired_tasks.front());
+      _expired_tasks.pop_front();
+      return task;
+    }
+    if (!_tasks.empty()) {
+      return pop_top();
+    }
+    return std::nullopt;
+  }
+
+  bool empty() const { return _tasks.empty() && _expired_tasks.empty(); }
+
+private:
+  // moves the task out of the heap, a std::priority_queue only gives const
+  // access to its top and would copy the task
+  Task pop_top() {
+    std::pop_heap(_tasks.begin(), _tasks.end(), std::greater<Entry>{});
+    auto task = std::move(_tasks.back().task);
+    _tasks.pop_back();
+    return task;
+  }
+
+  struct Entry {
+    TimePoint deadline;
+    size_t rank;
+    size_t sequence;
+    Task task;
+
+    bool operator>(const Entry &other) const {
+      if (deadline != other.deadline) {
+        return deadline > other.deadline;
+      }
+      if (rank != other.rank) {
+        return rank < other.rank;
+      }
+      return sequence > other.sequence;
+    }
+  };
+
+  // min heap on the deadline
+  std::vector<Entry> _tasks;
+  std::deque<Task> _expired_tasks;
+  size_t _sequence = 0;
+};
+
+// ready tasks of several clients, the clients with ready tasks take turns.
+// The tasks of a client are ordered by their deadline like in a ReadyQueue,
+// deadlines of different clients are not compared.
+class FairReadyQueue {
+public:
+  void push(Task task, TimePoint deadline, size_t rank, ClientId client) {
+    auto &queue = _queues[client];
+    if (queue.empty()) {
+      _turns.push_back(client);
+    }
+    queue.push(std::move(task), deadline, rank);
+  }
+
+  std::optional<Task> pop(TimePoint now) {
+    if (_turns.empty()) {
+      return std::nullopt;
+    }
+    const auto client = _turns.front();
+    _turns.pop_front();
+    const auto queue = _queues.find(client);
+    auto task = queue->second.pop(now);
+    // a client without ready tasks loses its queue, it gets a new one and a
+    // new turn once it has some again
+    if (queue->second.empty()) {
+      _queues.erase(queue);
+    } else {
+      _turns.push_back(client);
+    }
+    return task;
+  }
+
+  bool empty() const { return _turns.empty(); }
+  // clients with ready tasks
+  size_t nb_clients() const { return _queues.size(); }
+
+private:
+  std::unordered_map<ClientId, ReadyQueue> _queues;
+  // clients with ready tasks in the order of their next turn
+  std::deque<ClientId> _turns;
+};
+
+} // namespace par
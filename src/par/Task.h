@@ -3,9 +3,12 @@
 #include "par/Work.h"
 
 #include <memory>
+#include <utility>
 
 namespace par {
 
+class CompiledGraph;
+class Completion;
 class Executor;
 
 class Task {
@@ -15,15 +18,26 @@ public:
   Task(Task &&) = default;
   Task &operator=(const Task &) = default;
   Task &operator=(Task &&) = default;
-  virtual ~Task() = default;
-  Task(std::shared_ptr<Work> work) : _work{work} {}
+  ~Task() = default;
+  Task(std::shared_ptr<Work> work) : _work{std::move(work)} {}
 
   void succeed(Task &task);
+  void reserve_predecessors(size_t nb_predecessors) {
+    _work->reserve_predecessors(nb_predecessors);
+  }
+  void set_deadline(TimePoint deadline) { _work->set_deadline(deadline); }
+  void set_client(ClientId client) { _work->set_client(client); }
+  void set_cancellation_token(CancellationToken token) {
+    _work->set_cancellation_token(std::move(token));
+  }
 
 private:
-  std::shared_ptr<Work> get() const { return _work; }
+  // by reference, a copy would cost two atomic reference count updates
+  const std::shared_ptr<Work> &get() const { return _work; }
   std::shared_ptr<Work> _work;
   friend bool operator==(const Task &lhs, const Task &rhs);
+  friend class CompiledGraph;
+  friend class Completion;
   friend class Executor;
 };
 
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace par {
+
+// monotonic memory for the tasks of one task graph, e.g. of one frame. The
+// memory is released at once when the arena and all tasks allocated from it
+// are gone. The graph is built on one thread, so allocating is not
+// synchronized: only one thread at a time may allocate from the arena.
+class TaskArena {
+public:
+  // the blocks of an arena, every allocation counts as a user of them
+  class Memory {
+  public:
+    Memory(const Memory &) = delete;
+    Memory(Memory &&) = delete;
+    Memory &operator=(const Memory &) = delete;
+    Memory &operator=(Memory &&) = delete;
+    ~Memory() = default;
+
+    Memory(size_t block_size) : _block_size{block_size} {}
+
+    void *allocate(size_t size, size_t alignment) {
+      auto *memory = std::align(alignment, size, _current, _remaining);
+      if (!memory) {
+        add_block(std::max(_block_size, size + alignment));
+        memory = std::align(alignment, size, _current, _remaining);
+      }
+      _current = static_cast<std::byte *>(memory) + size;
+      _remaining -= size;
+      _nb_users.fetch_add(1, std::memory_order_relaxed);
+      return memory;
+    }
+
+    // the last user deletes the memory
+    void release() {
+      if (_nb_users.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+      }
+    }
+
+  private:
+    void add_block(size_t size) {
+      // not value initialized, the tasks construct themselves
+      _blocks.emplace_back(new std::byte[size]);
+      _current = _blocks.back().get();
+      _remaining = size;
+    }
+
+    std::vector<std::unique_ptr<std::byte[]>> _blocks;
+    void *_current = nullptr;
+    size_t _remaining = 0;
+    size_t _block_size;
+    // the arena itself is a user as well
+    std::atomic<size_t> _nb_users = 1;
+  };
+
+  TaskArena(const TaskArena &) = delete;
+  TaskArena(TaskArena &&) = delete;
+  TaskArena &operator=(const TaskArena &) = delete;
+  TaskArena &operator=(TaskArena &&) = delete;
+  ~TaskArena() { _memory->release(); }
+
+  // the memory is taken from the heap in blocks of block_size bytes. Blocks
+  // well below the mmap threshold of malloc are reused from frame to frame
+  // and do not fault in fresh pages.
+  TaskArena(size_t block_size = 64 * 1024)
+      : _memory{new Memory{block_size}} {}
+
+  void *allocate(size_t size, size_t alignment) {
+    return _memory->allocate(size, alignment);
+  }
+
+  Memory *get_memory() const { return _memory; }
+
+private:
+  Memory *_memory;
+};
+
+// allocator for std::allocate_shared. Every allocation keeps the memory of the
+// arena alive, copies of the allocator do not touch any reference count.
+template <class T> class ArenaAllocator {
+public:
+  using value_type = T;
+
+  ArenaAllocator(const std::shared_ptr<TaskArena> &arena)
+      : _memory{arena->get_memory()} {}
+  template <class U>
+  ArenaAllocator(const ArenaAllocator<U> &other)
+      : _memory{other.get_memory()} {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(_memory->allocate(n * sizeof(T), alignof(T)));
+  }
+  // the memory is given back once the arena and all allocations are gone
+  void deallocate(T *, size_t) { _memory->release(); }
+
+  TaskArena::Memory *get_memory() const { return _memory; }
+
+private:
+  TaskArena::Memory *_memory;
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T> &lhs, const ArenaAllocator<U> &rhs) {
+  return lhs.get_memory() == rhs.get_memory();
+}
+
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T> &lhs, const ArenaAllocator<U> &rhs) {
+  return !(lhs == rhs);
+}
+
+// allocates the object in the arena or on the heap if there is no arena
+template <class T, class... Args>
+std::shared_ptr<T> make_shared_in(const std::shared_ptr<TaskArena> &arena,
+                                  Args &&...args) {
+  if (!arena) {
+    return std::make_shared<T>(std::forward<Args>(args)...);
+  }
+  return std::allocate_shared<T>(ArenaAllocator<T>{arena},
+                                 std::forward<Args>(args)...);
+}
+
+} // namespace par
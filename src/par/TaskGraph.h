@@ -1,5 +1,6 @@
 #pragma once
 
+#include "par/CancellationToken.h"
 #include "par/Calculation.h"
 #include "par/Task.h"
 
@@ -14,12 +15,40 @@ struct TaskGraph {
   TaskGraph &operator=(const TaskGraph &) = default;
   TaskGraph &operator=(TaskGraph &&) = default;
 
+  // tasks of the graph should be created in its arena, which lives as long
+  // as any of them
+  TaskGraph(std::shared_ptr<TaskArena> arena) : _arena{std::move(arena)} {}
+
   void add_task(Task task) {
+    task.set_cancellation_token(_cancellation_token);
     _tasks.front().succeed(task);
     _tasks.push_back(task);
   }
 
-  std::vector<Task> get_tasks() const { return _tasks; }
+  const std::vector<Task> &get_tasks() const { return _tasks; }
+
+  void set_deadline(TimePoint deadline) {
+    for (auto &task : _tasks) {
+      task.set_deadline(deadline);
+    }
+  }
+
+  void set_client(ClientId client) {
+    for (auto &task : _tasks) {
+      task.set_client(client);
+    }
+  }
+
+  // tasks of the graph that have not started yet are skipped
+  void cancel() const { _cancellation_token.cancel(); }
+  bool is_cancelled() const { return _cancellation_token.is_cancelled(); }
+  const CancellationToken &get_cancellation_token() const {
+    return _cancellation_token;
+  }
+
+  const std::shared_ptr<TaskArena> &get_arena() const { return _arena; }
+
+  void reserve(size_t nb_tasks) { _tasks.reserve(nb_tasks + 1); }
 
   std::vector<Task> get_added_tasks() const {
     return std::vector<Task>(_tasks.begin() + 1, _tasks.end());
@@ -27,10 +56,13 @@ struct TaskGraph {
 
 private:
   Task create_dummy_finish_task() {
-    auto calc = Calculation{[]() -> void {}};
-    return calc.make_task();
+    auto task = make_task([]() -> void {}, nullptr, _arena);
+    task.set_cancellation_token(_cancellation_token);
+    return task;
   }
 
+  CancellationToken _cancellation_token;
+  std::shared_ptr<TaskArena> _arena;
   std::vector<Task> _tasks = {create_dummy_finish_task()};
 };
 
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "par/Calculation.h"
+#include "par/Task.h"
+#include "par/TaskArena.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace par {
+
+// splits an area into a grid of tiles of tile_size x tile_size pixels, tiles
+// at the right and bottom edge are clipped to the area. Rectangle needs the
+// members x, y, width, height and a constructor taking them in this order.
+template <class Rectangle> class TileGrid {
+public:
+  TileGrid() = default;
+  TileGrid(const TileGrid &) = default;
+  TileGrid(TileGrid &&) = default;
+  TileGrid &operator=(const TileGrid &) = default;
+  TileGrid &operator=(TileGrid &&) = default;
+
+  TileGrid(const Rectangle &area, int tile_size) : _tile_size{tile_size} {
+    if (_tile_size <= 0 || area.width <= 0 || area.height <= 0) {
+      return;
+    }
+    _rows = (area.height + _tile_size - 1) / _tile_size;
+    _cols = (area.width + _tile_size - 1) / _tile_size;
+    _tiles.reserve(_rows * _cols);
+    for (size_t row = 0; row < _rows; ++row) {
+      for (size_t col = 0; col < _cols; ++col) {
+        const int x = area.x + static_cast<int>(col) * _tile_size;
+        const int y = area.y + static_cast<int>(row) * _tile_size;
+        _tiles.emplace_back(x, y,
+                            std::min(_tile_size, area.x + area.width - x),
+                            std::min(_tile_size, area.y + area.height - y));
+      }
+    }
+  }
+
+  size_t get_rows() const { return _rows; }
+  size_t get_cols() const { return _cols; }
+  int get_tile_size() const { return _tile_size; }
+  const Rectangle &get_tile(size_t row, size_t col) const {
+    return _tiles[index(row, col)];
+  }
+  // tiles in row major order, the same order as the tasks of a stage
+  const std::vector<Rectangle> &get_tiles() const { return _tiles; }
+  size_t index(size_t row, size_t col) const { return row * _cols + col; }
+
+  // the number of neighbouring tile rings a stencil of radius pixels reaches
+  size_t halo_rings(int radius) const {
+    if (radius <= 0) {
+      return 0;
+    }
+    return static_cast<size_t>((radius + _tile_size - 1) / _tile_size);
+  }
+
+private:
+  std::vector<Rectangle> _tiles;
+  size_t _rows = 0;
+  size_t _cols = 0;
+  int _tile_size = 0;
+};
+
+// creates one task per tile, func is called with the tile and its grid row
+// and column. The tasks are allocated in the arena if one is given.
+template <class Rectangle, class Func>
+std::vector<Task> parallel_for(const TileGrid<Rectangle> &grid, Func func,
+                               const char *label = nullptr,
+                               const std::shared_ptr<TaskArena> &arena =
+                                   nullptr) {
+  std::vector<Task> tasks;
+  tasks.reserve(grid.get_tiles().size());
+  for (size_t row = 0; row < grid.get_rows(); ++row) {
+    for (size_t col = 0; col < grid.get_cols(); ++col) {
+      const auto &tile = grid.get_tile(row, col);
+      tasks.emplace_back(make_task(
+          [func, tile, row, col]() { func(tile, row, col); }, label, arena));
+    }
+  }
+  return tasks;
+}
+
+// like above, each tile task additionally succeeds the tasks of the previous
+// stage whose tiles lie within the stencil radius of its tile
+template <class Rectangle, class Func>
+std::vector<Task> parallel_for(const TileGrid<Rectangle> &grid,
+                               const std::vector<Task> &previous_stage,
+                               int radius, Func func,
+                               const char *label = nullptr,
+                               const std::shared_ptr<TaskArena> &arena =
+                                   nullptr) {
+  auto tasks = parallel_for(grid, func, label, arena);
+  const auto rings = grid.halo_rings(radius);
+  for (size_t row = 0; row < grid.get_rows(); ++row) {
+    const auto first_row = row >= rings ? row - rings : 0;
+    const auto last_row = std::min(row + rings, grid.get_rows() - 1);
+    for (size_t col = 0; col < grid.get_cols(); ++col) {
+      const auto first_col = col >= rings ? col - rings : 0;
+      const auto last_col = std::min(col + rings, grid.get_cols() - 1);
+      auto &task = tasks[grid.index(row, col)];
+      task.reserve_predecessors((last_row - first_row + 1) *
+                                (last_col - first_col + 1));
+      for (size_t r = first_row; r <= last_row; ++r) {
+        for (size_t c = first_col; c <= last_col; ++c) {
+          auto predecessor = previous_stage[grid.index(r, c)];
+          task.succeed(predecessor);
+        }
+      }
+    }
+  }
+  return tasks;
+}
+
+} // namespace par
@@ -0,0 +1,120 @@
+#pragma once
+
+// per task instrumentation, enable with -DPAR_TRACE=1 (cmake option
+// ENABLE_PAR_TRACE). When disabled no timestamps are taken and no trace data
+// is stored.
+#ifndef PAR_TRACE
+#define PAR_TRACE 0
+#endif
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace par {
+
+struct TaskTrace {
+  using time_point = std::chrono::high_resolution_clock::time_point;
+
+  const char *label = nullptr;
+  time_point queued;
+  time_point ready;
+  time_point started;
+  time_point finished;
+  size_t worker = 0;
+};
+
+// collects the traces of finished tasks, one buffer per worker so that
+// workers never contend while recording
+class TraceRecorder {
+public:
+  TraceRecorder() = default;
+  TraceRecorder(size_t nb_workers)
+      : _start{std::chrono::high_resolution_clock::now()} {
+    for (size_t i = 0; i < nb_workers; ++i) {
+      _buffers.push_back(std::make_unique<Buffer>());
+    }
+  }
+
+  void record(const TaskTrace &trace) {
+    auto &buffer = *_buffers[trace.worker];
+    std::unique_lock<std::mutex> lock(buffer.mutex);
+    buffer.traces.push_back(trace);
+  }
+
+  // writes all recorded tasks in the chrome trace event format which can be
+  // opened with perfetto or chrome://tracing
+  void write_chrome_trace(std::ostream &out) const {
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    const auto separate = [&]() {
+      if (!first) {
+        out << ",";
+      }
+      first = false;
+    };
+    for (size_t worker = 0; worker < _buffers.size(); ++worker) {
+      separate();
+      out << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+          << worker << ",\"args\":{\"name\":\"worker " << worker << "\"}}";
+    }
+    for (const auto &buffer : _buffers) {
+      std::unique_lock<std::mutex> lock(buffer->mutex);
+      for (const auto &trace : buffer->traces) {
+        separate();
+        out << "\n{\"name\":\""
+            << (trace.label ? escape(trace.label) : std::string{"task"})
+            << "\",\"cat\":\"par\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+            << trace.worker << ",\"ts\":" << to_us(trace.started)
+            << ",\"dur\":" << to_us(trace.finished) - to_us(trace.started)
+            << ",\"args\":{\"queued_us\":" << to_us(trace.queued)
+            << ",\"ready_us\":" << to_us(trace.ready)
+            << ",\"wait_for_predecessors_us\":"
+            << to_us(trace.ready) - to_us(trace.queued)
+            << ",\"wait_for_worker_us\":"
+            << to_us(trace.started) - to_us(trace.ready) << "}}";
+      }
+    }
+    out << "\n]}\n";
+  }
+
+  bool write_chrome_trace(const std::string &path) const {
+    auto file = std::ofstream{path};
+    if (!file) {
+      return false;
+    }
+    write_chrome_trace(file);
+    return static_cast<bool>(file);
+  }
+
+private:
+  double to_us(TaskTrace::time_point time_point) const {
+    return std::chrono::duration<double, std::micro>(time_point - _start)
+        .count();
+  }
+
+  static std::string escape(const std::string &label) {
+    std::string escaped;
+    for (const auto c : label) {
+      if (c == '"' || c == '\\') {
+        escaped += '\\';
+      }
+      escaped += c;
+    }
+    return escaped;
+  }
+
+  struct Buffer {
+    std::mutex mutex;
+    std::vector<TaskTrace> traces;
+  };
+
+  TaskTrace::time_point _start;
+  std::vector<std::unique_ptr<Buffer>> _buffers;
+};
+
+} // namespace par
@@ -1,38 +1,207 @@
 #pragma once
 
+#include "par/CancellationToken.h"
+#include "par/Tracing.h"
+
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <vector>
 
 namespace par{
 
-class Work {
+// cancelled works were skipped instead of called, they count as finished for
+// their successors and waiters
+enum class WorkState { Unknown, Queued, Ready, Running, Finished, Cancelled };
+
+using TimePoint = std::chrono::high_resolution_clock::time_point;
+
+// identifies who submitted a work, the global queue of an executor takes
+// turns between clients. Works of client 0 take the client of the task
+// submitting them.
+using ClientId = size_t;
+
+class Work : public std::enable_shared_from_this<Work> {
 public:
   Work() = default;
-  Work(const Work &) = default;
-  Work(Work &&) = default;
-  Work &operator=(const Work &) = default;
-  Work &operator=(Work &&) = default;
+  Work(const Work &) = delete;
+  Work(Work &&) = delete;
+  Work &operator=(const Work &) = delete;
+  Work &operator=(Work &&) = delete;
   virtual ~Work() = default;
 
   virtual void call() = 0;
   void add_predecessor(const std::shared_ptr<Work> &work) {
     _predecessors.push_back(work);
   }
-  bool can_be_started() const {
-    return std::all_of(
-        _predecessors.cbegin(), _predecessors.cend(),
-        [](const std::shared_ptr<Work> &work) { return work->is_finished(); });
+  void reserve_predecessors(size_t nb_predecessors) {
+    _predecessors.reserve(nb_predecessors);
+  }
+  // registers this work as successor of all its unfinished predecessors,
+  // returns true if none of them is unfinished and the work can be started
+  bool link_to_predecessors() {
+    _is_replayed = false;
+    _nb_unfinished_predecessors = _predecessors.size() + 1;
+    for (const auto &predecessor : _predecessors) {
+      if (!predecessor->add_successor(shared_from_this())) {
+        release_predecessor();
+      }
+    }
+    return release_predecessor();
+  }
+  // compiled graphs wire their works once, the successors are owned by the
+  // graph and only released while the work is replayed
+  void set_compiled_successors(std::vector<Work *> successors,
+                               size_t nb_compiled_predecessors) {
+    _compiled_successors = std::move(successors);
+    _nb_compiled_predecessors = nb_compiled_predecessors;
+  }
+  // queues the work for a replay of its compiled graph, returns true if it
+  // can be started right away
+  bool set_replayed() {
+    if (!set_queued()) {
+      return false;
+    }
+    _is_replayed = true;
+    _nb_unfinished_predecessors = _nb_compiled_predecessors;
+    return _nb_compiled_predecessors == 0;
+  }
+  WorkState get_state() const { return _state; }
+  // claims the work for execution, fails if it is already queued or running
+  bool set_queued() {
+    auto state = _state.load();
+    do {
+      if (state != WorkState::Unknown && state != WorkState::Finished &&
+          state != WorkState::Cancelled) {
+        return false;
+      }
+    } while (!_state.compare_exchange_weak(state, WorkState::Queued));
+    return true;
+  }
+  void set_ready() { _state = WorkState::Ready; }
+  // works without deadline are dispatched after all works with a deadline
+  void set_deadline(TimePoint deadline) { _deadline = deadline; }
+  TimePoint get_deadline() const { return _deadline; }
+  void set_client(ClientId client) { _client = client; }
+  ClientId get_client() const { return _client; }
+  // the number of works on the longest path from this work to the sink of
+  // its graph, ready works with a higher rank are dispatched first
+  void set_rank(size_t rank) { _rank = rank; }
+  size_t get_rank() const { return _rank; }
+  void set_label([[maybe_unused]] const char *label) {
+#if PAR_TRACE
+    _trace.label = label;
+#endif
+  }
+#if PAR_TRACE
+  TaskTrace &get_trace() { return _trace; }
+#endif
+  // must not be changed while the work is submitted
+  void set_cancellation_token(CancellationToken token) {
+    _cancellation_token = std::move(token);
+  }
+  bool is_cancellation_requested() const {
+    return _cancellation_token && _cancellation_token->is_cancelled();
+  }
+  void set_running() { _state = WorkState::Running; }
+  // true once the work is done, no matter if it was called or cancelled
+  bool is_finished() const {
+    const auto state = _state.load();
+    return state == WorkState::Finished || state == WorkState::Cancelled;
+  }
+  bool is_cancelled() const { return _state == WorkState::Cancelled; }
+  // runs the completion callbacks and returns the successors that can be
+  // started now that this work is finished
+  std::vector<std::shared_ptr<Work>> set_finished(bool is_cancelled = false) {
+    std::vector<std::shared_ptr<Work>> successors;
+    std::unique_lock<std::mutex> lock(_mutex);
+    // callbacks run before waiters are released, callbacks added while they
+    // run are picked up by the next round
+    while (!_completion_callbacks.empty()) {
+      auto callbacks = std::move(_completion_callbacks);
+      _completion_callbacks.clear();
+      lock.unlock();
+      for (const auto &callback : callbacks) {
+        callback();
+      }
+      lock.lock();
+    }
+    // the work may be replayed again as soon as it is finished
+    const auto is_replayed = _is_replayed;
+    _state = is_cancelled ? WorkState::Cancelled : WorkState::Finished;
+    successors.swap(_successors);
+    lock.unlock();
+    _finished_signal.notify_all();
+    successors.erase(std::remove_if(successors.begin(), successors.end(),
+                                    [](const std::shared_ptr<Work> &work) {
+                                      return !work->release_predecessor();
+                                    }),
+                     successors.end());
+    if (is_replayed) {
+      for (auto *successor : _compiled_successors) {
+        if (successor->release_predecessor()) {
+          successors.push_back(successor->shared_from_this());
+        }
+      }
+    }
+    return successors;
+  }
+  void wait_for_finished() const {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _finished_signal.wait(lock, [this]() { return is_finished(); });
+  }
+  bool wait_for_finished(std::chrono::microseconds timeout) const {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _finished_signal.wait_for(lock, timeout,
+                                     [this]() { return is_finished(); });
+  }
+  // the callback is called right away if the work is already finished
+  void add_completion_callback(std::function<void()> callback) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (!is_finished()) {
+      _completion_callbacks.push_back(std::move(callback));
+      return;
+    }
+    lock.unlock();
+    callback();
   }
-  bool is_finished() const { return _finished; }
-  void set_finished() { _finished = true; }
   const std::vector<std::shared_ptr<Work>> &get_predecessors() const {
     return _predecessors;
   }
 
 private:
+  bool add_successor(const std::shared_ptr<Work> &work) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (is_finished()) {
+      return false;
+    }
+    _successors.push_back(work);
+    return true;
+  }
+  bool release_predecessor() { return --_nb_unfinished_predecessors == 0; }
+
   std::vector<std::shared_ptr<Work>> _predecessors;
-  bool _finished = false;
+  std::vector<std::shared_ptr<Work>> _successors;
+  std::vector<Work *> _compiled_successors;
+  std::vector<std::function<void()>> _completion_callbacks;
+  std::atomic<size_t> _nb_unfinished_predecessors = 0;
+  size_t _nb_compiled_predecessors = 0;
+  bool _is_replayed = false;
+  std::atomic<WorkState> _state = WorkState::Unknown;
+  TimePoint _deadline = TimePoint::max();
+  ClientId _client = 0;
+  size_t _rank = 0;
+  std::optional<CancellationToken> _cancellation_token;
+#if PAR_TRACE
+  TaskTrace _trace;
+#endif
+  mutable std::mutex _mutex;
+  mutable std::condition_variable _finished_signal;
 };
 
-} // namespace par
\ No newline at end of file
+} // namespace par
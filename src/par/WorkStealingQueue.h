@@ -0,0 +1,52 @@
+#pragma once
+
+#include "par/Task.h"
+
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace par {
+
+// per worker deque: the owning worker pushes and pops at the back (LIFO),
+// other workers steal from the front (FIFO)
+class WorkStealingQueue {
+public:
+  WorkStealingQueue() = default;
+  WorkStealingQueue(const WorkStealingQueue &) = delete;
+  WorkStealingQueue(WorkStealingQueue &&) = delete;
+  WorkStealingQueue &operator=(const WorkStealingQueue &) = delete;
+  WorkStealingQueue &operator=(WorkStealingQueue &&) = delete;
+
+  void push(Task task) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _tasks.push_back(std::move(task));
+  }
+
+  std::optional<Task> pop() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_tasks.empty()) {
+      return std::nullopt;
+    }
+    auto task = std::move(_tasks.back());
+    _tasks.pop_back();
+    return task;
+  }
+
+  std::optional<Task> steal() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_tasks.empty()) {
+      return std::nullopt;
+    }
+    auto task = std::move(_tasks.front());
+    _tasks.pop_front();
+    return task;
+  }
+
+private:
+  std::mutex _mutex;
+  std::deque<Task> _tasks;
+};
+
+} // namespace par
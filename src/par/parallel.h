@@ -1,7 +1,14 @@
 #pragma once
 
+#include "par/Affinity.h"
+#include "par/CancellationToken.h"
+#include "par/CompiledGraph.h"
 #include "par/Work.h"
+#include "par/Completion.h"
 #include "par/Task.h"
 #include "par/Executor.h"
 #include "par/Calculation.h"
-#include "par/Flow.h"
\ No newline at end of file
+#include "par/Flow.h"
+#include "par/MpmcQueue.h"
+#include "par/TaskArena.h"
+#include "par/TileGrid.h"
\ No newline at end of file
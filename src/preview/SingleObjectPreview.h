@@ -10,6 +10,7 @@
 #include <optional>
 #include <sstream>
 #include <string>
+#include <utility>
 
 namespace preview {
 
@@ -23,14 +24,19 @@ struct SingleObjectPreview : public VideoPreview {
     calculate_target();
   }
 
+  SingleObjectPreview(std::shared_ptr<par::Executor> executor,
+                      std::string ascii_art,
+                      deduct::SkeletonParams skeleton_params,
+                      deduct::ComparisonParams comparison_params)
+      : VideoPreview(std::move(executor)), _ascii_art{ascii_art},
+        _skeleton_params{skeleton_params}, _comparison_params{
+                                               comparison_params} {
+    calculate_target();
+  }
+
   virtual ~SingleObjectPreview() {
-    bool do_wait = true;
-    for (auto task : _current_task_graph.get_tasks()) {
-      do_wait = do_wait && !_executor.does_not_know(task);
-    }
-    if (get_frame_calculation_status() == FrameCalculationStatus::IN_PROGRESS) {
-      _executor.wait_for(_current_task_graph);
-    }
+    _current_task_graph.cancel();
+    _current_frame.wait();
   }
 
   void adjust_task_graph(par::TaskGraph &task_graph) override {
@@ -118,8 +124,8 @@ private:
 
     auto frame_data = webcam::FrameData{img};
     auto flow = webcam::process_frame_single_loop(frame_data, img);
-    _executor.run(flow);
-    _executor.wait_for(flow);
+    _executor->run(flow, _client);
+    _executor->wait_for(flow);
     auto objects = frame_data.result_objects.get_objects();
 
     const auto target_pixel = find_target_pixel(_ascii_art);
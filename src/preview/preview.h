@@ -4,10 +4,13 @@
 #include "par/parallel.h"
 #include "webcam/webcam.h"
 
+#include <atomic>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace preview {
@@ -28,34 +31,29 @@ inline std::string to_string(FrameCalculationStatus status) {
 }
 
 struct VideoPreview {
-  VideoPreview() = default;
+  // shares the executor of the process with the other previews
+  VideoPreview() : VideoPreview(par::get_shared_executor()) {}
   VideoPreview(const VideoPreview &) = delete;
   VideoPreview(VideoPreview &&) = delete;
   VideoPreview &operator=(const VideoPreview &) = delete;
   VideoPreview &operator=(VideoPreview &&) = delete;
 
   virtual ~VideoPreview() {
-    bool do_wait = true;
-    for(auto task : _current_task_graph.get_tasks()) {
-      do_wait = do_wait && !_executor.does_not_know(task);
-    }
-    if (_frame_calculation_status == FrameCalculationStatus::IN_PROGRESS && do_wait) {
-      _executor.wait_for(_current_task_graph);
-    }
+    _current_task_graph.cancel();
+    _current_frame.wait();
   }
 
-  VideoPreview(size_t num_threads) : _executor(num_threads) {}
-
-  void update_calculation_status() {
-    bool is_done =
-        _executor.wait_for(_current_task_graph, std::chrono::microseconds(0));
-    if (is_done) {
-      std::unique_lock<std::mutex> lock(_processed_mutex);
-      _processed_frame_data = std::move(_current_frame_data);
-      _current_original.release();
-      _frame_calculation_status = FrameCalculationStatus::DONE;
-    }
-  }
+  VideoPreview(size_t num_threads)
+      : VideoPreview(
+            std::make_shared<par::Executor>(static_cast<int>(num_threads))) {}
+  // pins the workers, previews sharing a machine can each own distinct cores
+  VideoPreview(size_t num_threads, par::Affinity affinity)
+      : VideoPreview(std::make_shared<par::Executor>(
+            static_cast<int>(num_threads), par::Scheduling::GlobalQueue,
+            affinity)) {}
+  // previews sharing an executor take turns with their frames
+  VideoPreview(std::shared_ptr<par::Executor> executor)
+      : _executor{std::move(executor)}, _client{_executor->add_client()} {}
 
   FrameCalculationStatus get_frame_calculation_status() {
     return _frame_calculation_status;
@@ -73,6 +71,10 @@ struct VideoPreview {
 
   void set_mat(cv::Mat const &mat, od::Rectangle const &rectangle, int rings,
                int gradient_threshold) {
+    // drop the rest of the previous frame, only its running tasks are waited
+    // for as they still use the frame data
+    _current_task_graph.cancel();
+    _current_frame.wait();
     _frame_calculation_status = FrameCalculationStatus::IN_PROGRESS;
     _rectangles_query_status = RectanglesQueryStatus::NOT_REQUESTED;
     _current_original = mat.clone();
@@ -80,19 +82,45 @@ struct VideoPreview {
     _current_task_graph = webcam::process_frame_single_loop(_current_frame_data,
                                                             _current_original);
     adjust_task_graph(_current_task_graph);
-    _executor.run(_current_task_graph);
+    _current_frame = _executor->run(_current_task_graph, _client);
+    _current_frame.on_completion(
+        [this, token = _current_task_graph.get_cancellation_token()]() {
+          if (!token.is_cancelled()) {
+            set_frame_calculated();
+          }
+        });
+  }
+
+  // drops the new frame instead of the previous one, returns false if the
+  // previous frame is still being processed
+  bool try_set_mat(cv::Mat const &mat, od::Rectangle const &rectangle,
+                   int rings, int gradient_threshold) {
+    if (!_current_frame.is_done()) {
+      return false;
+    }
+    set_mat(mat, rectangle, rings, gradient_threshold);
+    return true;
   }
 
   virtual void adjust_task_graph([[maybe_unused]] par::TaskGraph &task_graph) {}
 
 protected:
-  par::Executor _executor;
+  std::shared_ptr<par::Executor> _executor;
+  par::ClientId _client = 0;
   webcam::FrameData _current_frame_data;
   par::TaskGraph _current_task_graph;
+  par::Completion _current_frame;
 private:
+  void set_frame_calculated() {
+    std::unique_lock<std::mutex> lock(_processed_mutex);
+    _processed_frame_data = std::move(_current_frame_data);
+    _current_original.release();
+    _frame_calculation_status = FrameCalculationStatus::DONE;
+  }
+
   cv::Mat _current_original;
   webcam::FrameData _processed_frame_data;
-  FrameCalculationStatus _frame_calculation_status =
+  std::atomic<FrameCalculationStatus> _frame_calculation_status =
       FrameCalculationStatus::NOT_STARTED;
   RectanglesQueryStatus _rectangles_query_status =
       RectanglesQueryStatus::NOT_REQUESTED;
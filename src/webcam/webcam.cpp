@@ -3,7 +3,11 @@
 #include "opencv2/imgproc/imgproc.hpp"
 
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace webcam {
 
@@ -90,12 +94,8 @@ par::Task process_frame(FrameData &frame_data, const cv::Mat &imgOriginal,
       std::cout << "all rectangles processed" << std::endl;
     };
 
-    auto flow = par::Flow{};
-    // const auto calcCountoursTask = executor.emplace(calcCountours);
-    flow.add(par::Calculation{calcGradient});
-    flow.add(par::Calculation{calcSmoothedContours});
-    // auto calcSmoothedGradientTask = taskflow.emplace(calcSmoothedGradient);
-    flow.add(par::Calculation{calcAllRectangles});
+    auto flow =
+        par::StaticFlow{calcGradient, calcSmoothedContours, calcAllRectangles};
     return flow.make_task();
   };
 
@@ -167,7 +167,8 @@ par::TaskGraph process_frame_quadview(FrameData &frame_data,
             imgOriginal, expand_if_necessary(rect, imgOriginal));
         frame_data.all_objects.get(row, col) = objects_per_rectangle;
       };
-      deduce_tasks.emplace_back(par::Calculation{lambda}.make_task());
+      deduce_tasks.emplace_back(
+          par::Calculation{lambda, "objects"}.make_task());
     }
   }
 
@@ -191,10 +192,14 @@ par::TaskGraph process_frame_quadview(FrameData &frame_data,
     frame_data.all_rectangles =
         od::deduce_rectangles(frame_data.result_objects);
   };
-  auto merge_first_row_task = par::Calculation{merge_first_row}.make_task();
-  auto merge_second_row_task = par::Calculation{merge_second_row}.make_task();
-  auto merge_rows_task = par::Calculation{merge_rows}.make_task();
-  auto calc_rectangles_task = par::Calculation{calc_rectangles}.make_task();
+  auto merge_first_row_task =
+      par::Calculation{merge_first_row, "merge first row"}.make_task();
+  auto merge_second_row_task =
+      par::Calculation{merge_second_row, "merge second row"}.make_task();
+  auto merge_rows_task =
+      par::Calculation{merge_rows, "merge rows"}.make_task();
+  auto calc_rectangles_task =
+      par::Calculation{calc_rectangles, "rectangles"}.make_task();
   for (auto &task : deduce_tasks) {
     merge_first_row_task.succeed(task);
     merge_second_row_task.succeed(task);
@@ -215,117 +220,54 @@ par::TaskGraph process_frame_quadview(FrameData &frame_data,
   return taskgraph;
 }
 
-od::Rectangle expand_rectangle(const od::Rectangle &rectangle, int rings) {
-  return od::Rectangle{rectangle.x - rings, rectangle.y - rings,
-                       rectangle.width + 2 * rings,
-                       rectangle.height + 2 * rings};
-}
-
-std::vector<size_t>
-deduce_touching_rectangles(const od::Rectangle &rectangle,
-                           const std::vector<od::Rectangle> &rectangles) {
-  std::vector<size_t> touching_rectangles;
-  touching_rectangles.reserve(9);
-  size_t i = 0;
-  const auto target_rect = rectangle.to_math2d_rectangle();
-  for (const auto &rect : rectangles) {
-    const auto current_math_rect = rect.to_math2d_rectangle();
-    if (current_math_rect.intersects(target_rect) || rectangle.contains(rect)) {
-      touching_rectangles.emplace_back(i);
-    }
-    i++;
-  }
-  return touching_rectangles;
-}
-
-std::vector<od::Rectangle>
-split_rectangle_into_parts(const od::Rectangle &rectangle,
-                           int nb_pixels_per_tile) {
-  constexpr auto debug = false;
-  std::vector<od::Rectangle> rectangles;
-  for (size_t y = rectangle.y; y < rectangle.y + rectangle.height;
-       y += nb_pixels_per_tile) {
-    for (size_t x = rectangle.x; x < rectangle.x + rectangle.width;
-         x += nb_pixels_per_tile) {
-      rectangles.emplace_back(x, y, nb_pixels_per_tile, nb_pixels_per_tile);
-    }
-  }
-  if constexpr (debug) {
-    std::cout << "Rectangles: " << std::endl;
-    for (const auto &rect : rectangles) {
-      std::cout << "x: " << rect.x << " y: " << rect.y
-                << " width: " << rect.width << " height: " << rect.height
-                << std::endl;
-    }
-  }
-  return rectangles;
-}
-
 FrameData process_frame_merged(const cv::Mat &imgOriginal,
                                const od::Rectangle &rectangle,
                                par::Executor &executor, int rings,
                                int gradient_threshold, int nb_pixels_per_tile) {
   constexpr auto debug = false;
   auto frame_data = FrameData{imgOriginal};
-  const auto rectangles =
-      split_rectangle_into_parts(rectangle, nb_pixels_per_tile);
-  std::vector<par::Task> gradient_tasks;
-  gradient_tasks.reserve(rectangles.size());
-  std::vector<par::Task> smoothing_tasks;
-  smoothing_tasks.reserve(rectangles.size());
-
-  for (const auto &rect : rectangles) {
-    const auto calcGradient = [&, rect]() {
-      if constexpr (debug)
-        std::cout << "calculating gradient for rect " << rect.to_string()
-                  << std::endl;
-      od::detect_directions(frame_data.gradient, imgOriginal, rect);
-      if constexpr (debug)
-        std::cout << "gradient processedfor rect " << rect.to_string()
-                  << std::endl;
-    };
-    auto calculation = par::Calculation{calcGradient};
-    gradient_tasks.emplace_back(calculation.make_task());
-  }
-
-  for (const auto &rect : rectangles) {
-    const auto calcSmoothedContours = [&, rect, rings, gradient_threshold]() {
-      if constexpr (debug)
-        std::cout << "calculating smoothed contours for rect "
-                  << rect.to_string() << std::endl;
-      od::smooth_angles(frame_data.smoothed_contours_mat, frame_data.gradient,
-                        rings, true, gradient_threshold, rect);
-      if constexpr (debug)
-        std::cout << "smoothed contours processed for rect " << rect.to_string()
-                  << std::endl;
-    };
-    const auto calcAllRectangles = [&, rect]() {
-      if constexpr (debug)
-        std::cout << "calculating all rectangles for rect " << rect.to_string()
-                  << std::endl;
-      od::establishing_shot_slices(frame_data.all_rectangles,
-                                   frame_data.smoothed_contours_mat, rect);
-      if constexpr (debug)
-        std::cout << "all rectangles processed for rect " << rect.to_string()
-                  << std::endl;
-    };
-    auto flow = par::Flow{};
-    flow.add(par::Calculation{calcSmoothedContours});
-    flow.add(par::Calculation{calcAllRectangles});
+  const auto grid =
+      par::TileGrid<od::Rectangle>{rectangle, nb_pixels_per_tile};
+  // all tasks of the frame are allocated in one arena
+  const auto arena = std::make_shared<par::TaskArena>();
 
-    smoothing_tasks.emplace_back(flow.make_task());
-  }
+  const auto calcGradient = [&](const od::Rectangle &rect, size_t, size_t) {
+    if constexpr (debug)
+      std::cout << "calculating gradient for rect " << rect.to_string()
+                << std::endl;
+    od::detect_directions(frame_data.gradient, imgOriginal, rect);
+    if constexpr (debug)
+      std::cout << "gradient processedfor rect " << rect.to_string()
+                << std::endl;
+  };
+  auto gradient_tasks =
+      par::parallel_for(grid, calcGradient, "gradient", arena);
 
-  // define dependencies between tasks
-  size_t i = 0;
-  for (const auto &rect : rectangles) {
-    std::vector<size_t> touching_rectangles =
-        deduce_touching_rectangles(expand_rectangle(rect, rings), rectangles);
-    for (const auto &touching_rectangle : touching_rectangles) {
-      smoothing_tasks[i].succeed(gradient_tasks[touching_rectangle]);
-    }
-    i++;
-  }
+  const auto calcSmoothedContours = [&](const od::Rectangle &rect, size_t,
+                                        size_t) {
+    if constexpr (debug)
+      std::cout << "calculating smoothed contours for rect " << rect.to_string()
+                << std::endl;
+    od::smooth_angles(frame_data.smoothed_contours_mat, frame_data.gradient,
+                      rings, true, gradient_threshold, rect);
+  };
+  const auto calcAllRectangles = [&](const od::Rectangle &rect, size_t,
+                                     size_t) {
+    if constexpr (debug)
+      std::cout << "calculating all rectangles for rect " << rect.to_string()
+                << std::endl;
+    od::establishing_shot_slices(frame_data.all_rectangles,
+                                 frame_data.smoothed_contours_mat, rect);
+    if constexpr (debug)
+      std::cout << "all rectangles processed for rect " << rect.to_string()
+                << std::endl;
+  };
+  // smoothing a tile reads the gradient of the tiles within rings pixels, the
+  // rectangles of the tile are sliced right after while it is still cached
+  auto smoothing_tasks = par::parallel_for(
+      grid, gradient_tasks, rings,
+      par::StaticFlow{calcSmoothedContours, calcAllRectangles},
+      "smoothing and rectangles", arena);
 
   // kick off tasks
   for (auto &gradient_task : gradient_tasks) {
@@ -336,230 +278,229 @@ FrameData process_frame_merged(const cv::Mat &imgOriginal,
   }
 
   for (auto &gradient_task : gradient_tasks) {
-    executor.wait_for(gradient_task);
+    executor.wait_for(gradient_task, par::Waiting::Help);
   }
   for (auto &smoothing_task : smoothing_tasks) {
-    executor.wait_for(smoothing_task);
+    executor.wait_for(smoothing_task, par::Waiting::Help);
   }
   return frame_data;
 }
 
-FrameData process_frame_merge_objects(const cv::Mat &imgOriginal,
-                                      const od::Rectangle &rectangle,
-                                      par::Executor &executor, int rings,
-                                      int gradient_threshold,
-                                      int nb_pixels_per_tile) {
+std::vector<par::Task>
+make_gradient_tasks(const par::Binding<FrameData> &frame_data,
+                    const par::Binding<const cv::Mat> &imgOriginal,
+                    const par::TileGrid<od::Rectangle> &grid,
+                    const std::shared_ptr<par::TaskArena> &arena) {
   constexpr auto debug = false;
-  auto frame_data = FrameData{imgOriginal};
-  const auto rectangles =
-      split_rectangle_into_parts(rectangle, nb_pixels_per_tile);
-  std::vector<par::Task> gradient_tasks;
-  gradient_tasks.reserve(rectangles.size());
-  std::vector<par::Task> smoothing_tasks;
-  smoothing_tasks.reserve(rectangles.size());
-
-  for (const auto &rect : rectangles) {
-    const auto calcGradient = [&, rect]() {
-      if constexpr (debug)
-        std::cout << "calculating gradient for rect " << rect.to_string()
-                  << std::endl;
-      od::detect_directions(frame_data.gradient, imgOriginal, rect);
-      if constexpr (debug)
-        std::cout << "gradient processedfor rect " << rect.to_string()
-                  << std::endl;
-    };
-    auto calculation = par::Calculation{calcGradient};
-    gradient_tasks.emplace_back(calculation.make_task());
-  }
-
+  const auto calcGradient = [frame_data, imgOriginal](const od::Rectangle &rect,
+                                                      size_t, size_t) {
+    if constexpr (debug)
+      std::cout << "calculating gradient for rect " << rect.to_string()
+                << std::endl;
+    od::detect_directions(frame_data.get().gradient, imgOriginal.get(), rect);
+    if constexpr (debug)
+      std::cout << "gradient processedfor rect " << rect.to_string()
+                << std::endl;
+  };
   // print all rectangles:
   if constexpr (debug) {
-    for (const auto &rect : rectangles) {
+    for (const auto &rect : grid.get_tiles()) {
       std::cout << "rect: " << rect.to_string() << std::endl;
     }
   }
+  return par::parallel_for(grid, calcGradient, "gradient", arena);
+}
 
-  frame_data.all_objects = od::AllObjects{
-      static_cast<size_t>(rectangle.height / nb_pixels_per_tile) + 1,
-      static_cast<size_t>(rectangle.width / nb_pixels_per_tile) + 1};
-  for (const auto &rect : rectangles) {
-    const auto calcSmoothedContours = [&, rect, rings, gradient_threshold]() {
-      if constexpr (debug)
-        std::cout << "calculating smoothed contours for rect "
-                  << rect.to_string() << std::endl;
-      od::smooth_angles(frame_data.smoothed_contours_mat, frame_data.gradient,
-                        rings, true, gradient_threshold, rect);
-      if constexpr (debug)
-        std::cout << "smoothed contours processed for rect " << rect.to_string()
-                  << std::endl;
+// the stages of process_frame_merge_objects from the gradient of the tiles to
+// the rectangles of the merged objects, all_objects must have one entry per
+// tile
+par::TaskGraph
+make_tile_objects_graph(const par::Binding<FrameData> &frame_data,
+                        const par::Binding<const cv::Mat> &imgOriginal,
+                        const par::TileGrid<od::Rectangle> &grid, int rings,
+                        int gradient_threshold,
+                        const std::shared_ptr<par::TaskArena> &arena) {
+  constexpr auto debug = false;
+  auto gradient_tasks =
+      make_gradient_tasks(frame_data, imgOriginal, grid, arena);
+  const auto calcSmoothedContours = [frame_data, rings, gradient_threshold](
+                                        const od::Rectangle &rect, size_t,
+                                        size_t) {
+    auto &data = frame_data.get();
+    if constexpr (debug)
+      std::cout << "calculating smoothed contours for rect " << rect.to_string()
+                << std::endl;
+    od::smooth_angles(data.smoothed_contours_mat, data.gradient, rings, true,
+                      gradient_threshold, rect);
+  };
+  const auto calcAllObjects = [frame_data](const od::Rectangle &rect,
+                                           size_t row, size_t col) {
+    auto &data = frame_data.get();
+    if constexpr (debug)
+      std::cout << "calculating all objects for rect " << rect.to_string()
+                << std::endl;
+    od::establishing_shot_objects(data.all_objects.get(row, col),
+                                  data.smoothed_contours_mat, rect);
+    if constexpr (debug)
+      std::cout << "all objects processed for rect " << rect.to_string()
+                << std::endl;
+  };
+  auto smoothing_tasks = par::parallel_for(
+      grid, gradient_tasks, rings,
+      par::StaticFlow{calcSmoothedContours, calcAllObjects},
+      "smoothing and objects", arena);
+
+  // merges the objects of all tiles, each row is appended down as soon as its
+  // objects are appended right. The append down chain is the critical path of
+  // the graph and its rows are dispatched first.
+  auto line_objects =
+      std::make_shared<std::vector<od::ObjectsPerRectangle>>(grid.get_rows());
+  std::vector<par::Task> merge_tasks;
+  merge_tasks.reserve(2 * grid.get_rows() + 1);
+  std::optional<par::Task> previous_append_down;
+  for (size_t row = 0; row < grid.get_rows(); ++row) {
+    const auto append_right = [frame_data, line_objects, row,
+                               cols = grid.get_cols()]() {
+      auto &all_objects = frame_data.get().all_objects;
+      auto &objects = (*line_objects)[row];
+      objects = all_objects.get(row, 0);
+      for (size_t col = 1; col < cols; ++col) {
+        if constexpr (debug)
+          std::cout << "Appending right row " << row << " col " << col
+                    << std::endl;
+        objects.append_right(all_objects.get(row, col));
+      }
     };
-    const auto calcAllObjects = [&, rect]() {
-      if constexpr (debug)
-        std::cout << "calculating all rectangles for rect " << rect.to_string()
-                  << std::endl;
-      od::establishing_shot_objects(
-          frame_data.all_objects.get(rect.y / nb_pixels_per_tile,
-                                     rect.x / nb_pixels_per_tile),
-          frame_data.smoothed_contours_mat, rect);
+    auto append_right_task =
+        par::make_task(append_right, "append right", arena);
+    append_right_task.reserve_predecessors(grid.get_cols());
+    for (size_t col = 0; col < grid.get_cols(); ++col) {
+      append_right_task.succeed(smoothing_tasks[grid.index(row, col)]);
+    }
+    const auto append_down = [frame_data, line_objects, row]() {
+      auto &result_objects = frame_data.get().result_objects;
+      if (row == 0) {
+        result_objects = (*line_objects)[0];
+        return;
+      }
       if constexpr (debug)
-        std::cout << "all rectangles processed for rect " << rect.to_string()
-                  << std::endl;
+        std::cout << "Appending down row " << row << std::endl;
+      result_objects.append_down((*line_objects)[row]);
     };
-    auto flow = par::Flow{};
-    flow.add(par::Calculation{calcSmoothedContours});
-    flow.add(par::Calculation{calcAllObjects});
-
-    smoothing_tasks.emplace_back(flow.make_task());
-  }
-
-  // define dependencies between tasks
-  size_t i = 0;
-  for (const auto &rect : rectangles) {
-    std::vector<size_t> touching_rectangles =
-        deduce_touching_rectangles(expand_rectangle(rect, rings), rectangles);
-    for (const auto &touching_rectangle : touching_rectangles) {
-      smoothing_tasks[i].succeed(gradient_tasks[touching_rectangle]);
+    auto append_down_task = par::make_task(append_down, "append down", arena);
+    append_down_task.succeed(append_right_task);
+    if (previous_append_down) {
+      append_down_task.succeed(*previous_append_down);
     }
-    i++;
-  }
-
-  // kick off tasks
+    merge_tasks.push_back(append_right_task);
+    merge_tasks.push_back(append_down_task);
+    previous_append_down = append_down_task;
+  }
+  auto deduce_rectangles_task = par::make_task(
+      [frame_data]() {
+        auto &data = frame_data.get();
+        data.all_rectangles = od::deduce_rectangles(data.result_objects);
+      },
+      "deduce rectangles", arena);
+  if (previous_append_down) {
+    deduce_rectangles_task.succeed(*previous_append_down);
+  }
+  merge_tasks.push_back(deduce_rectangles_task);
+
+  auto task_graph = par::TaskGraph{arena};
+  task_graph.reserve(gradient_tasks.size() + smoothing_tasks.size() +
+                     merge_tasks.size());
   for (auto &gradient_task : gradient_tasks) {
-    executor.run(gradient_task);
-  }
-  for (auto &smoothing_task : smoothing_tasks) {
-    executor.run(smoothing_task);
-  }
-
-  for (auto &gradient_task : gradient_tasks) {
-    executor.wait_for(gradient_task);
+    task_graph.add_task(gradient_task);
   }
   for (auto &smoothing_task : smoothing_tasks) {
-    executor.wait_for(smoothing_task);
-  }
-  if constexpr (debug) {
-    // print all rectangles in the matrix
-    for (size_t row = 0; row < frame_data.all_objects.get_rows(); ++row) {
-      for (size_t col = 0; col < frame_data.all_objects.get_cols(); ++col) {
-        std::cout << "row " << row << " col " << col << ": ";
-        std::cout
-            << frame_data.all_objects.get(row, col).get_rectangle().to_string()
-            << std::endl;
-        for (const auto &object :
-             frame_data.all_objects.get(row, col).get_objects()) {
-          std::cout << "object: " << object.get_bounding_box().to_string()
-                    << std::endl;
-        }
-      }
-    }
-  }
-  // merge all objects
-  std::vector<par::Task> append_right_tasks;
-  std::vector<od::ObjectsPerRectangle> line_objects;
-  for (size_t row = 0; row < frame_data.all_objects.get_rows(); ++row) {
-    line_objects.emplace_back(frame_data.all_objects.get(row, 0));
-    auto flow = par::Flow{};
-    for (size_t col = 1; col < frame_data.all_objects.get_cols(); ++col) {
-      const auto append_right = [&, row, col]() {
-        if constexpr (debug) {
-          std::cout << "Appending right row " << row << " col " << col
-                    << std::endl;
-        }
-        line_objects[row].append_right(frame_data.all_objects.get(row, col));
-        if constexpr (debug)
-          std::cout << "Finished appending right row " << row << " col " << col
-                    << std::endl;
-      };
-      flow.add(par::Calculation{append_right});
-    }
-    append_right_tasks.emplace_back(flow.make_task());
-  }
-  for (const auto &task : append_right_tasks) {
-    executor.run(task);
-  }
-  for (const auto &task : append_right_tasks) {
-    executor.wait_for(task);
+    task_graph.add_task(smoothing_task);
   }
-  frame_data.result_objects = line_objects[0];
-  for (size_t i = 1; i < line_objects.size(); ++i) {
-    if constexpr (debug)
-      std::cout << "Appending down row " << i << std::endl;
-    frame_data.result_objects.append_down(line_objects[i]);
-    if constexpr (debug)
-      std::cout << "Finished appending down row " << i << std::endl;
+  for (auto &merge_task : merge_tasks) {
+    task_graph.add_task(merge_task);
   }
+  return task_graph;
+}
 
-  frame_data.all_rectangles = od::deduce_rectangles(frame_data.result_objects);
-
+FrameData process_frame_merge_objects(const cv::Mat &imgOriginal,
+                                      const od::Rectangle &rectangle,
+                                      par::Executor &executor, int rings,
+                                      int gradient_threshold,
+                                      int nb_pixels_per_tile) {
+  auto frame_data = FrameData{imgOriginal};
+  const auto grid =
+      par::TileGrid<od::Rectangle>{rectangle, nb_pixels_per_tile};
+  frame_data.all_objects = od::AllObjects{grid.get_rows(), grid.get_cols()};
+  auto frame_data_binding = par::Binding<FrameData>{};
+  frame_data_binding.bind(frame_data);
+  auto original_binding = par::Binding<const cv::Mat>{};
+  original_binding.bind(imgOriginal);
+  // all tasks of the frame are allocated in one arena
+  auto task_graph = make_tile_objects_graph(
+      frame_data_binding, original_binding, grid, rings, gradient_threshold,
+      std::make_shared<par::TaskArena>());
+
+  executor.run(task_graph);
+  executor.wait_for(task_graph, par::Waiting::Help);
   return frame_data;
 }
 
-par::TaskGraph process_frame_with_parallel_gradient(
-    FrameData &frame_data, const cv::Mat &imgOriginal,
-    const od::Rectangle &rectangle, int rings, int gradient_threshold,
-    int nb_pixels_per_tile) {
-  constexpr auto debug = false;
-  const auto rectangles =
-      split_rectangle_into_parts(rectangle, nb_pixels_per_tile);
-  std::vector<par::Task> gradient_tasks;
-  gradient_tasks.reserve(rectangles.size());
-  std::vector<par::Task> smoothing_tasks;
-  smoothing_tasks.reserve(rectangles.size());
-
-  for (const auto &rect : rectangles) {
-    const auto calcGradient = [&, rect]() {
-      if constexpr (debug)
-        std::cout << "calculating gradient for rect " << rect.to_string()
-                  << std::endl;
-      od::detect_directions(frame_data.gradient, imgOriginal, rect);
-      if constexpr (debug)
-        std::cout << "gradient processedfor rect " << rect.to_string()
-                  << std::endl;
-    };
-    auto calculation = par::Calculation{calcGradient};
-    gradient_tasks.emplace_back(calculation.make_task());
-  }
-
-  // print all rectangles:
-  if constexpr (debug) {
-    for (const auto &rect : rectangles) {
-      std::cout << "rect: " << rect.to_string() << std::endl;
-    }
-  }
-
-  frame_data.all_objects = od::AllObjects{
-      static_cast<size_t>(rectangle.height / nb_pixels_per_tile) + 1,
-      static_cast<size_t>(rectangle.width / nb_pixels_per_tile) + 1};
-  for (const auto &rect : rectangles) {
-    const auto calcSmoothedContours = [&, rect, rings, gradient_threshold]() {
-      if constexpr (debug)
-        std::cout << "calculating smoothed contours for rect "
-                  << rect.to_string() << std::endl;
-      od::smooth_angles(frame_data.smoothed_contours_mat, frame_data.gradient,
-                        rings, true, gradient_threshold, rect);
-      if constexpr (debug)
-        std::cout << "smoothed contours processed for rect " << rect.to_string()
-                  << std::endl;
-    };
-
-    auto calc = par::Calculation{calcSmoothedContours};
-
-    smoothing_tasks.emplace_back(calc.make_task());
+MergeObjectsGraph::MergeObjectsGraph(const od::Rectangle &rectangle, int rings,
+                                     int gradient_threshold,
+                                     int nb_pixels_per_tile)
+    : _grid{rectangle, nb_pixels_per_tile},
+      _graph{make_tile_objects_graph(_frame_data, _original, _grid, rings,
+                                     gradient_threshold,
+                                     std::make_shared<par::TaskArena>())} {}
+
+FrameData MergeObjectsGraph::process(const cv::Mat &imgOriginal,
+                                     par::Executor &executor) {
+  // the bindings must not change while the previous frame is replayed
+  if (!_graph.reset()) {
+    throw std::runtime_error(
+        "MergeObjectsGraph::process: the previous frame is running");
   }
+  auto frame_data = FrameData{imgOriginal};
+  frame_data.all_objects = od::AllObjects{_grid.get_rows(), _grid.get_cols()};
+  _frame_data.bind(frame_data);
+  _original.bind(imgOriginal);
+  executor.run(_graph);
+  executor.wait_for(_graph.get_sink(), par::Waiting::Help);
+  return frame_data;
+}
 
-  // define dependencies between tasks
-  size_t i = 0;
-  for (const auto &rect : rectangles) {
-    std::vector<size_t> touching_rectangles =
-        deduce_touching_rectangles(expand_rectangle(rect, rings), rectangles);
-    for (const auto &touching_rectangle : touching_rectangles) {
-      smoothing_tasks[i].succeed(gradient_tasks[touching_rectangle]);
-    }
-    i++;
-  }
+par::TaskGraph
+make_parallel_gradient_graph(const par::Binding<FrameData> &frame_data,
+                             const par::Binding<const cv::Mat> &imgOriginal,
+                             const od::Rectangle &rectangle, int rings,
+                             int gradient_threshold, int nb_pixels_per_tile) {
+  constexpr auto debug = false;
+  const auto grid =
+      par::TileGrid<od::Rectangle>{rectangle, nb_pixels_per_tile};
+  // all tasks of the frame are allocated in one arena
+  const auto arena = std::make_shared<par::TaskArena>();
+  auto gradient_tasks =
+      make_gradient_tasks(frame_data, imgOriginal, grid, arena);
+
+  const auto calcSmoothedContours = [frame_data, rings, gradient_threshold](
+                                        const od::Rectangle &rect, size_t,
+                                        size_t) {
+    if constexpr (debug)
+      std::cout << "calculating smoothed contours for rect " << rect.to_string()
+                << std::endl;
+    od::smooth_angles(frame_data.get().smoothed_contours_mat,
+                      frame_data.get().gradient, rings, true,
+                      gradient_threshold, rect);
+    if constexpr (debug)
+      std::cout << "smoothed contours processed for rect " << rect.to_string()
+                << std::endl;
+  };
+  auto smoothing_tasks = par::parallel_for(
+      grid, gradient_tasks, rings, calcSmoothedContours, "smoothing", arena);
 
   // kick off tasks
-  auto task_graph = par::TaskGraph{};
+  auto task_graph = par::TaskGraph{arena};
+  task_graph.reserve(gradient_tasks.size() + smoothing_tasks.size() + 1);
   for (auto &gradient_task : gradient_tasks) {
     task_graph.add_task(gradient_task);
   }
@@ -568,19 +509,22 @@ par::TaskGraph process_frame_with_parallel_gradient(
   }
 
   // merge all objects
-  const auto calcAllRectangles = [&, rectangle]() {
+  const auto calcAllRectangles = [frame_data, rectangle]() {
     if constexpr (debug) {
       std::cout << "calculating all rectangles" << std::endl;
     }
-    od::establishing_shot_slices(frame_data.all_rectangles,
-                                 frame_data.smoothed_contours_mat, rectangle);
+    od::establishing_shot_slices(frame_data.get().all_rectangles,
+                                 frame_data.get().smoothed_contours_mat,
+                                 rectangle);
     if constexpr (debug) {
       std::cout << "all rectangles processed" << std::endl;
     }
   };
 
-  auto calc = par::Calculation(calcAllRectangles);
+  auto calc = par::Calculation(calcAllRectangles, "all rectangles", arena);
   auto objects_task = calc.make_task();
+  objects_task.reserve_predecessors(gradient_tasks.size() +
+                                    smoothing_tasks.size());
   for (auto &task : gradient_tasks) {
     objects_task.succeed(task);
   }
@@ -594,4 +538,37 @@ par::TaskGraph process_frame_with_parallel_gradient(
   return task_graph;
 }
 
-} // namespace webcam
\ No newline at end of file
+par::TaskGraph process_frame_with_parallel_gradient(
+    FrameData &frame_data, const cv::Mat &imgOriginal,
+    const od::Rectangle &rectangle, int rings, int gradient_threshold,
+    int nb_pixels_per_tile) {
+  auto frame_data_binding = par::Binding<FrameData>{};
+  frame_data_binding.bind(frame_data);
+  auto original_binding = par::Binding<const cv::Mat>{};
+  original_binding.bind(imgOriginal);
+  return make_parallel_gradient_graph(frame_data_binding, original_binding,
+                                      rectangle, rings, gradient_threshold,
+                                      nb_pixels_per_tile);
+}
+
+ParallelGradientGraph::ParallelGradientGraph(const od::Rectangle &rectangle,
+                                             int rings, int gradient_threshold,
+                                             int nb_pixels_per_tile)
+    : _graph{make_parallel_gradient_graph(_frame_data, _original, rectangle,
+                                          rings, gradient_threshold,
+                                          nb_pixels_per_tile)} {}
+
+par::Completion ParallelGradientGraph::run(par::Executor &executor,
+                                           FrameData &frame_data,
+                                           const cv::Mat &imgOriginal) {
+  // the bindings must not change while the previous frame is replayed
+  if (!_graph.reset()) {
+    throw std::runtime_error(
+        "ParallelGradientGraph::run: the previous frame is running");
+  }
+  _frame_data.bind(frame_data);
+  _original.bind(imgOriginal);
+  return executor.run(_graph);
+}
+
+} // namespace webcam
@@ -79,4 +79,48 @@ par::TaskGraph process_frame_with_parallel_gradient(
     const od::Rectangle &rectangle, int rings, int gradient_threshold,
     int nb_pixels_per_tile = 100);
 
+// compiles the stages of process_frame_merge_objects, including the merge of
+// the tile objects, once for a frame size and replays them for every frame
+class MergeObjectsGraph {
+public:
+  MergeObjectsGraph(const od::Rectangle &rectangle, int rings,
+                    int gradient_threshold, int nb_pixels_per_tile = 100);
+  MergeObjectsGraph(const MergeObjectsGraph &) = delete;
+  MergeObjectsGraph(MergeObjectsGraph &&) = delete;
+  MergeObjectsGraph &operator=(const MergeObjectsGraph &) = delete;
+  MergeObjectsGraph &operator=(MergeObjectsGraph &&) = delete;
+
+  // throws std::runtime_error if the previous frame is still running
+  FrameData process(const cv::Mat &imgOriginal, par::Executor &executor);
+
+private:
+  par::Binding<FrameData> _frame_data;
+  par::Binding<const cv::Mat> _original;
+  par::TileGrid<od::Rectangle> _grid;
+  par::CompiledGraph _graph;
+};
+
+// compiles the task graph of process_frame_with_parallel_gradient once for a
+// frame size and replays it for every frame
+class ParallelGradientGraph {
+public:
+  ParallelGradientGraph(const od::Rectangle &rectangle, int rings,
+                        int gradient_threshold, int nb_pixels_per_tile = 100);
+  ParallelGradientGraph(const ParallelGradientGraph &) = delete;
+  ParallelGradientGraph(ParallelGradientGraph &&) = delete;
+  ParallelGradientGraph &operator=(const ParallelGradientGraph &) = delete;
+  ParallelGradientGraph &operator=(ParallelGradientGraph &&) = delete;
+
+  // frame_data and imgOriginal must stay alive until the replay is done.
+  // Throws std::runtime_error, without touching the running frame, if the
+  // previous frame is still running.
+  par::Completion run(par::Executor &executor, FrameData &frame_data,
+                      const cv::Mat &imgOriginal);
+
+private:
+  par::Binding<FrameData> _frame_data;
+  par::Binding<const cv::Mat> _original;
+  par::CompiledGraph _graph;
+};
+
 } // namespace webcam
\ No newline at end of file
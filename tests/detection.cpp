@@ -0,0 +1,78 @@
+#include <catch2/catch_all.hpp>
+
+#include "detection/DetectionImpl.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<detail::GradientRow> get_supported_gradient_rows() {
+  std::vector<detail::GradientRow> gradient_rows = {
+      detail::gradient_row_scalar};
+#if DETECTION_SIMD
+  if (__builtin_cpu_supports("sse4.1")) {
+    gradient_rows.push_back(detail::gradient_row_sse41);
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    gradient_rows.push_back(detail::gradient_row_avx2);
+  }
+#endif
+  return gradient_rows;
+}
+
+bool is_bit_identical(float lhs, float rhs) {
+  return std::memcmp(&lhs, &rhs, sizeof(float)) == 0;
+}
+
+TEST_CASE("Detection", "[detection]") {
+
+  SECTION("GradientRowsMatchGradientOfEachPixel") {
+    // long enough for every vector width and a scalar rest
+    constexpr int nb_pixels = 45;
+    auto random = std::mt19937{42};
+    auto distribution = std::uniform_int_distribution<int>{0, 255};
+    std::vector<std::vector<uchar>> rows(3, std::vector<uchar>(nb_pixels + 2));
+    for (auto &row : rows) {
+      for (auto &pixel : row) {
+        pixel = static_cast<uchar>(distribution(random));
+      }
+    }
+    // flat and saturated neighbourhoods
+    std::fill(rows[0].begin(), rows[0].begin() + 10, uchar{0});
+    std::fill(rows[1].begin(), rows[1].begin() + 10, uchar{0});
+    std::fill(rows[2].begin(), rows[2].begin() + 10, uchar{255});
+    const auto &up = rows[0];
+    const auto &center = rows[1];
+    const auto &down = rows[2];
+
+    for (const auto gradient_row : get_supported_gradient_rows()) {
+      std::vector<float> grad_x(nb_pixels);
+      std::vector<float> grad_y(nb_pixels);
+      std::vector<float> grad_total(nb_pixels);
+      gradient_row(up.data(), center.data(), down.data(), nb_pixels,
+                   grad_x.data(), grad_y.data(), grad_total.data());
+      for (int k = 0; k < nb_pixels; ++k) {
+        float expected_x = 0;
+        float expected_y = 0;
+        float expected_total = 0;
+        detail::gradient_components(up[k], up[k + 1], up[k + 2], center[k],
+                                    center[k + 2], down[k], down[k + 1],
+                                    down[k + 2], expected_x, expected_y,
+                                    expected_total);
+        CHECK(is_bit_identical(grad_x[k], expected_x));
+        CHECK(is_bit_identical(grad_y[k], expected_y));
+        CHECK(is_bit_identical(grad_total[k], expected_total));
+        const auto expected =
+            detail::gradient<detail::DetectionType::Angle, 0>(
+                up[k], up[k + 1], up[k + 2], center[k], center[k + 1],
+                center[k + 2], down[k], down[k + 1], down[k + 2]);
+        CHECK(detail::gradient_of<detail::DetectionType::Angle, 0>(
+                  grad_x[k], grad_y[k], grad_total[k]) == expected);
+      }
+    }
+  }
+}
+
+} // namespace
@@ -0,0 +1,997 @@
+#include <catch2/catch_all.hpp>
+
+#include "par/Calc.h"
+#include "par/Coroutine.h"
+#include "par/Mail.h"
+#include "par/Poll.h"
+#include "par/parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Rect {
+  Rect(int xx, int yy, int w, int h) : x{xx}, y{yy}, width{w}, height{h} {}
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+};
+
+struct CountingAddressee : public par::Addressee {
+  void receive() override { receive_batch(1); }
+  void receive_batch(size_t nb_messages) override {
+    nb_deliveries++;
+    nb_received += nb_messages;
+  }
+  std::atomic<size_t> nb_deliveries = 0;
+  std::atomic<size_t> nb_received = 0;
+};
+
+struct MeetingAddressee : public par::Addressee {
+  MeetingAddressee(std::atomic<int> &nb_receiving, std::atomic<int> &nb_met)
+      : _nb_receiving{nb_receiving}, _nb_met{nb_met} {}
+  void receive() override {
+    _nb_receiving++;
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (_nb_receiving < 2 && std::chrono::steady_clock::now() < end) {
+      std::this_thread::yield();
+    }
+    if (_nb_receiving >= 2) {
+      _nb_met++;
+    }
+  }
+  std::atomic<int> &_nb_receiving;
+  std::atomic<int> &_nb_met;
+};
+
+#if PAR_COROUTINES
+par::Async<int> add_on_worker(par::Executor &executor, int lhs, int rhs,
+                              std::thread::id &thread_id) {
+  co_await executor.schedule();
+  thread_id = std::this_thread::get_id();
+  auto calc = par::Calc<int()>{[lhs, rhs]() { return lhs + rhs; }};
+  executor.run(calc.make_task());
+  co_return co_await calc;
+}
+
+par::Async<int> double_on_worker(par::Executor &executor, int value,
+                                 std::thread::id &thread_id) {
+  const auto sum = co_await add_on_worker(executor, value, value, thread_id);
+  auto task_graph = par::TaskGraph{};
+  task_graph.add_task(par::make_task([]() {}));
+  executor.run(task_graph);
+  co_await task_graph;
+  co_return sum;
+}
+
+par::Async<> fail_on_worker(par::Executor &executor) {
+  co_await executor.schedule();
+  throw std::runtime_error("failed");
+}
+#endif
+
+TEST_CASE("Par", "[par]") {
+
+  SECTION("ExecutorRunsDependentTasksInOrder") {
+    par::Executor executor(4);
+    std::mutex mutex;
+    std::vector<int> order;
+    const auto append = [&](int i) {
+      return par::Calculation{[&, i]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        order.push_back(i);
+      }};
+    };
+    auto first = append(1).make_task();
+    auto second = append(2).make_task();
+    auto third = append(3).make_task();
+    second.succeed(first);
+    third.succeed(second);
+    executor.run(third);
+    executor.run(second);
+    executor.run(first);
+    executor.wait_for(third);
+    CHECK(order == std::vector<int>{1, 2, 3});
+  }
+
+  SECTION("ExecutorWaitForReturnsAsSoonAsTaskIsFinished") {
+    par::Executor executor(2);
+    auto task = par::Calculation{[]() {}}.make_task();
+    executor.run(task);
+    const auto start = std::chrono::high_resolution_clock::now();
+    executor.wait_for(task);
+    const auto elapsed = std::chrono::high_resolution_clock::now() - start;
+    CHECK(elapsed < std::chrono::milliseconds(100));
+  }
+
+  SECTION("ExecutorWaitForTimesOutOnUnfinishedTask") {
+    par::Executor executor(2);
+    auto never_run = par::Calculation{[]() {}}.make_task();
+    CHECK_FALSE(executor.wait_for(never_run, std::chrono::microseconds(100)));
+  }
+
+  SECTION("ExecutorRunsDelayedTask") {
+    par::Executor executor(2);
+    auto task = par::Calculation{[]() {}}.make_task();
+    const auto start = std::chrono::high_resolution_clock::now();
+    executor.run_in(task, std::chrono::milliseconds(5));
+    executor.wait_for(task);
+    const auto elapsed = std::chrono::high_resolution_clock::now() - start;
+    CHECK(elapsed >= std::chrono::milliseconds(5));
+  }
+
+  SECTION("ExecutorRunsDelayedTasksInStartTimeOrder") {
+    par::Executor executor(1);
+    std::mutex mutex;
+    std::vector<int> order;
+    std::vector<par::Task> tasks;
+    for (int i : {3, 1, 2}) {
+      auto task = par::Calculation{[&, i]() {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    order.push_back(i);
+                  }}.make_task();
+      executor.run_in(task, std::chrono::milliseconds(5 * i));
+      tasks.push_back(task);
+    }
+    for (auto &task : tasks) {
+      executor.wait_for(task);
+    }
+    CHECK(order == std::vector<int>{1, 2, 3});
+  }
+
+  SECTION("ExecutorRunsTaskGraph") {
+    par::Executor executor(4);
+    std::atomic<int> counter = 0;
+    auto task_graph = par::TaskGraph{};
+    for (int i = 0; i < 100; ++i) {
+      task_graph.add_task(par::Calculation{[&]() { counter++; }}.make_task());
+    }
+    executor.run(task_graph);
+    executor.wait_for(task_graph);
+    CHECK(counter == 100);
+  }
+
+  SECTION("WorkStealingExecutorRunsTaskGraph") {
+    par::Executor executor(4, par::Scheduling::WorkStealing);
+    std::atomic<int> counter = 0;
+    std::vector<par::Task> first_stage;
+    auto task_graph = par::TaskGraph{};
+    for (int i = 0; i < 100; ++i) {
+      auto task = par::Calculation{[&]() { counter++; }}.make_task();
+      first_stage.push_back(task);
+      task_graph.add_task(task);
+    }
+    for (int i = 0; i < 100; ++i) {
+      auto task = par::Calculation{[&]() { counter++; }}.make_task();
+      task.succeed(first_stage[i]);
+      if (i > 0) {
+        task.succeed(first_stage[i - 1]);
+      }
+      task_graph.add_task(task);
+    }
+    executor.run(task_graph);
+    executor.wait_for(task_graph);
+    CHECK(counter == 200);
+  }
+
+  SECTION("ExecutorStartsSuccessorOnceAllPredecessorsFinished") {
+    par::Executor executor(4);
+    std::atomic<int> nb_finished_predecessors = 0;
+    std::atomic<int> nb_finished_when_started = -1;
+    std::atomic<int> nb_calls = 0;
+    auto successor = par::Calculation{[&]() {
+                       nb_finished_when_started = nb_finished_predecessors.load();
+                       nb_calls++;
+                     }}.make_task();
+    std::vector<par::Task> predecessors;
+    for (int i = 0; i < 50; ++i) {
+      auto predecessor =
+          par::Calculation{[&]() { nb_finished_predecessors++; }}.make_task();
+      successor.succeed(predecessor);
+      predecessors.push_back(predecessor);
+    }
+    executor.run(predecessors[0]);
+    executor.wait_for(predecessors[0]);
+    executor.run(successor);
+    for (size_t i = 1; i < predecessors.size(); ++i) {
+      executor.run(predecessors[i]);
+    }
+    executor.wait_for(successor);
+    CHECK(nb_calls == 1);
+    CHECK(nb_finished_when_started == 50);
+  }
+
+  SECTION("ExecutorTracksTaskState") {
+    par::Executor executor(2);
+    std::atomic<int> nb_calls = 0;
+    auto predecessor = par::Calculation{[&]() { nb_calls++; }}.make_task();
+    auto task = par::Calculation{[&]() { nb_calls++; }}.make_task();
+    task.succeed(predecessor);
+    CHECK(executor.does_not_know(task));
+    executor.run(task);
+    executor.run(task);
+    CHECK_FALSE(executor.does_not_know(task));
+    CHECK_FALSE(executor.wait_for(task, std::chrono::microseconds(100)));
+    executor.run(predecessor);
+    executor.wait_for(task);
+    CHECK_FALSE(executor.does_not_know(task));
+    CHECK(nb_calls == 2);
+  }
+
+  SECTION("HelpingWaitForRunsTasksOnCallingThread") {
+    par::Executor executor(1);
+    std::atomic<bool> is_started = false;
+    std::atomic<bool> is_released = false;
+    auto gate = par::Calculation{[&]() {
+                  is_started = true;
+                  while (!is_released) {
+                    std::this_thread::yield();
+                  }
+                }}.make_task();
+    executor.run(gate);
+    while (!is_started) {
+      std::this_thread::yield();
+    }
+    std::thread::id executing_thread;
+    auto task = par::Calculation{[&]() {
+                  executing_thread = std::this_thread::get_id();
+                }}.make_task();
+    executor.run(task);
+    executor.wait_for(task, par::Waiting::Help);
+    CHECK(executing_thread == std::this_thread::get_id());
+    is_released = true;
+    executor.wait_for(gate);
+  }
+
+  SECTION("HelpingWaitForAllowsNestedWaits") {
+    par::Executor executor(1);
+    std::atomic<int> nb_calls = 0;
+    auto outer = par::Calculation{[&]() {
+                   auto inner =
+                       par::Calculation{[&]() { nb_calls++; }}.make_task();
+                   executor.run(inner);
+                   executor.wait_for(inner, par::Waiting::Help);
+                   nb_calls++;
+                 }}.make_task();
+    executor.run(outer);
+    executor.wait_for(outer);
+    CHECK(nb_calls == 2);
+  }
+
+  SECTION("ExecutorDispatchesEarliestDeadlineFirst") {
+    par::Executor executor(1);
+    std::atomic<bool> is_released = false;
+    std::mutex mutex;
+    std::vector<std::string> order;
+    const auto record = [&](std::string name) {
+      return par::Calculation{[&, name]() {
+               std::unique_lock<std::mutex> lock(mutex);
+               order.push_back(name);
+             }}.make_task();
+    };
+    auto gate = par::Calculation{[&]() {
+                  while (!is_released) {
+                    std::this_thread::yield();
+                  }
+                }}.make_task();
+    executor.run(gate);
+    const auto now = std::chrono::high_resolution_clock::now();
+    auto background = record("background");
+    auto stale = record("stale");
+    auto later = record("later");
+    auto sooner = record("sooner");
+    executor.run(background);
+    executor.run(stale, now - std::chrono::seconds(1));
+    executor.run(later, now + std::chrono::seconds(20));
+    executor.run(sooner, now + std::chrono::seconds(10));
+    is_released = true;
+    executor.wait_for(background);
+    CHECK(order ==
+          std::vector<std::string>{"sooner", "later", "stale", "background"});
+  }
+
+  SECTION("ExecutorDispatchesCriticalPathFirst") {
+    par::Executor executor(1);
+    std::atomic<bool> is_released = false;
+    std::mutex mutex;
+    std::vector<std::string> order;
+    const auto record = [&](std::string name) {
+      return par::make_task([&, name]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        order.push_back(name);
+      });
+    };
+    executor.run(par::make_task([&]() {
+      while (!is_released) {
+        std::this_thread::yield();
+      }
+    }));
+    auto task_graph = par::TaskGraph{};
+    task_graph.add_task(record("short0"));
+    task_graph.add_task(record("short1"));
+    auto chain0 = record("chain0");
+    auto chain1 = record("chain1");
+    auto chain2 = record("chain2");
+    chain1.succeed(chain0);
+    chain2.succeed(chain1);
+    task_graph.add_task(chain0);
+    task_graph.add_task(chain1);
+    task_graph.add_task(chain2);
+    executor.run(task_graph);
+    is_released = true;
+    executor.wait_for(task_graph);
+    CHECK(order == std::vector<std::string>{"chain0", "chain1", "short0",
+                                            "short1", "chain2"});
+  }
+
+  SECTION("ExecutorWithoutWorkersWritesNoTrace") {
+    auto executor = par::Executor{};
+    const auto path =
+        (std::filesystem::temp_directory_path() / "par_no_trace.json").string();
+    CHECK_FALSE(executor.write_trace(path));
+  }
+
+  SECTION("ExecutorWritesChromeTraceIfEnabled") {
+    par::Executor executor(2);
+    auto task_graph = par::TaskGraph{};
+    task_graph.add_task(par::Calculation{[]() {}, "traced task"}.make_task());
+    executor.run(task_graph);
+    executor.wait_for(task_graph);
+    const auto path =
+        (std::filesystem::temp_directory_path() / "par_trace.json").string();
+    const bool is_written = executor.write_trace(path);
+    CHECK(is_written == static_cast<bool>(PAR_TRACE));
+    if (is_written) {
+      auto file = std::ifstream{path};
+      const auto json = std::string{std::istreambuf_iterator<char>{file}, {}};
+      CHECK(json.find("\"traceEvents\"") != std::string::npos);
+      CHECK(json.find("\"traced task\"") != std::string::npos);
+      std::filesystem::remove(path);
+    }
+  }
+
+  SECTION("ParsesLinuxCpuList") {
+    CHECK(par::parse_cpu_list("0-3,8\n") == std::vector<int>{0, 1, 2, 3, 8});
+    CHECK(par::parse_cpu_list("").empty());
+    CHECK(par::parse_cpu_list("a-b").empty());
+  }
+
+  SECTION("ExecutorReportsWorkerCores") {
+    par::Executor unpinned(2);
+    CHECK(unpinned.get_worker_cores() == std::vector<int>{-1, -1});
+    par::Executor pinned(2, par::Scheduling::GlobalQueue,
+                         par::Affinity::cores({0}));
+    CHECK(pinned.get_worker_cores() == std::vector<int>{0, 0});
+    auto task = par::Calculation{[]() {}}.make_task();
+    pinned.run(task);
+    pinned.wait_for(task);
+  }
+
+  SECTION("TileGridClipsEdgeTiles") {
+    const auto grid = par::TileGrid<Rect>{Rect{10, 20, 250, 120}, 100};
+    CHECK(grid.get_rows() == 2);
+    CHECK(grid.get_cols() == 3);
+    CHECK(grid.get_tile(1, 2).x == 210);
+    CHECK(grid.get_tile(1, 2).y == 120);
+    CHECK(grid.get_tile(1, 2).width == 50);
+    CHECK(grid.get_tile(1, 2).height == 20);
+    CHECK(grid.halo_rings(0) == 0);
+    CHECK(grid.halo_rings(1) == 1);
+    CHECK(grid.halo_rings(101) == 2);
+  }
+
+  SECTION("ParallelForWaitsForHaloOfPreviousStage") {
+    par::Executor executor(4);
+    const auto grid = par::TileGrid<Rect>{Rect{0, 0, 400, 300}, 100};
+    std::vector<std::atomic<bool>> is_done(grid.get_tiles().size());
+    std::atomic<int> nb_missing_predecessors = 0;
+    auto first_stage = par::parallel_for(
+        grid, [&](const Rect &, size_t row, size_t col) {
+          is_done[grid.index(row, col)] = true;
+        });
+    auto second_stage = par::parallel_for(
+        grid, first_stage, 1, [&](const Rect &, size_t row, size_t col) {
+          for (size_t r = row > 0 ? row - 1 : 0;
+               r <= std::min(row + 1, grid.get_rows() - 1); ++r) {
+            for (size_t c = col > 0 ? col - 1 : 0;
+                 c <= std::min(col + 1, grid.get_cols() - 1); ++c) {
+              if (!is_done[grid.index(r, c)]) {
+                nb_missing_predecessors++;
+              }
+            }
+          }
+        });
+    for (auto &task : second_stage) {
+      executor.run(task);
+    }
+    for (auto &task : first_stage) {
+      executor.run(task);
+    }
+    for (auto &task : second_stage) {
+      executor.wait_for(task);
+    }
+    CHECK(nb_missing_predecessors == 0);
+  }
+
+  SECTION("CompletionReportsFinishedTaskGraph") {
+    par::Executor executor(2);
+    std::atomic<bool> is_released = false;
+    std::atomic<int> nb_callbacks = 0;
+    auto task_graph = par::TaskGraph{};
+    task_graph.add_task(par::Calculation{[&]() {
+                          while (!is_released) {
+                            std::this_thread::yield();
+                          }
+                        }}.make_task());
+    auto completion = executor.run(task_graph);
+    completion.on_completion([&]() { nb_callbacks++; });
+    CHECK_FALSE(completion.is_done());
+    CHECK_FALSE(completion.wait_for(std::chrono::microseconds(100)));
+    is_released = true;
+    completion.wait();
+    CHECK(completion.is_done());
+    CHECK(nb_callbacks == 1);
+    completion.on_completion([&]() { nb_callbacks++; });
+    CHECK(nb_callbacks == 2);
+  }
+
+  SECTION("CancelledTaskGraphSkipsTasksNotStarted") {
+    par::Executor executor(1);
+    std::atomic<bool> is_started = false;
+    std::atomic<bool> is_released = false;
+    std::atomic<int> nb_calls = 0;
+    auto gate = par::Calculation{[&]() {
+                  is_started = true;
+                  while (!is_released) {
+                    std::this_thread::yield();
+                  }
+                }}.make_task();
+    executor.run(gate);
+    while (!is_started) {
+      std::this_thread::yield();
+    }
+    auto task_graph = par::TaskGraph{};
+    std::vector<par::Task> tasks;
+    for (int i = 0; i < 10; ++i) {
+      auto task = par::Calculation{[&]() { nb_calls++; }}.make_task();
+      if (!tasks.empty()) {
+        task.succeed(tasks.back());
+      }
+      tasks.push_back(task);
+      task_graph.add_task(task);
+    }
+    auto completion = executor.run(task_graph);
+    task_graph.cancel();
+    is_released = true;
+    completion.wait();
+    CHECK(completion.is_done());
+    CHECK(completion.is_cancelled());
+    CHECK(nb_calls == 0);
+    CHECK(par::Completion{tasks.back()}.is_cancelled());
+  }
+
+  SECTION("TaskArenaLivesAsLongAsItsTasks") {
+    par::Executor executor(2);
+    std::atomic<int> counter = 0;
+    auto arena = std::make_shared<par::TaskArena>(1024);
+    const auto weak_arena = std::weak_ptr<par::TaskArena>{arena};
+    {
+      auto task_graph = par::TaskGraph{arena};
+      auto flow = par::Flow{"flow", arena};
+      flow.add(par::Calculation{[&]() { counter++; }, "calculation", arena});
+      task_graph.add_task(flow.make_task());
+      for (int i = 0; i < 100; ++i) {
+        task_graph.add_task(
+            par::make_task([&]() { counter++; }, "task", arena));
+      }
+      arena.reset();
+      executor.run(task_graph);
+      executor.wait_for(task_graph);
+      CHECK_FALSE(weak_arena.expired());
+    }
+    CHECK(counter == 101);
+    // workers may still hold on to the last task for a moment
+    for (int i = 0; i < 1000 && !weak_arena.expired(); ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(weak_arena.expired());
+  }
+
+  SECTION("TaskArenaMemoryOutlivesArena") {
+    par::Executor executor(2);
+    std::atomic<int> counter = 0;
+    std::vector<par::Task> tasks;
+    {
+      // small blocks, so that the tasks span several of them
+      auto arena = std::make_shared<par::TaskArena>(256);
+      for (int i = 0; i < 100; ++i) {
+        tasks.push_back(par::make_task([&]() { counter++; }, "task", arena));
+      }
+    }
+    for (const auto &task : tasks) {
+      executor.run(task);
+    }
+    for (const auto &task : tasks) {
+      executor.wait_for(task);
+    }
+    CHECK(counter == 100);
+  }
+
+  SECTION("CompiledGraphReplaysWithNewBindings") {
+    par::Executor executor(4);
+    auto input = par::Binding<const std::vector<int>>{};
+    auto output = par::Binding<std::vector<int>>{};
+    auto task_graph = par::TaskGraph{};
+    std::vector<par::Task> doubling_tasks;
+    for (size_t i = 0; i < 8; ++i) {
+      auto task = par::make_task(
+          [input, output, i]() { output.get()[i] = 2 * input.get()[i]; });
+      doubling_tasks.push_back(task);
+      task_graph.add_task(task);
+    }
+    auto sum = par::make_task([output]() {
+      for (size_t i = 0; i < 8; ++i) {
+        output.get()[8] += output.get()[i];
+      }
+    });
+    for (auto &task : doubling_tasks) {
+      sum.succeed(task);
+    }
+    task_graph.add_task(sum);
+    auto compiled_graph = par::CompiledGraph{task_graph};
+    CHECK(compiled_graph.get_tasks().size() == 10);
+    CHECK(compiled_graph.get_roots().size() == 8);
+    CHECK(compiled_graph.get_sink() == task_graph.get_tasks().front());
+    for (int frame = 0; frame < 3; ++frame) {
+      const auto frame_input = std::vector<int>(8, frame);
+      auto frame_output = std::vector<int>(9, 0);
+      input.bind(frame_input);
+      output.bind(frame_output);
+      executor.run(compiled_graph).wait();
+      CHECK(frame_output[8] == 16 * frame);
+    }
+  }
+
+  SECTION("CompiledGraphReplaysAfterCancelledReplay") {
+    par::Executor executor(1);
+    std::atomic<bool> is_started = false;
+    std::atomic<bool> is_released = false;
+    auto gate = par::Calculation{[&]() {
+                  is_started = true;
+                  while (!is_released) {
+                    std::this_thread::yield();
+                  }
+                }}.make_task();
+    std::atomic<int> nb_calls = 0;
+    auto task_graph = par::TaskGraph{};
+    task_graph.add_task(par::make_task([&]() { nb_calls++; }));
+    auto compiled_graph = par::CompiledGraph{task_graph};
+    executor.run(gate);
+    while (!is_started) {
+      std::this_thread::yield();
+    }
+    auto completion = executor.run(compiled_graph);
+    CHECK_THROWS_AS(executor.run(compiled_graph), std::runtime_error);
+    compiled_graph.cancel();
+    is_released = true;
+    completion.wait();
+    CHECK(completion.is_cancelled());
+    CHECK(nb_calls == 0);
+    executor.run(compiled_graph).wait();
+    CHECK(nb_calls == 1);
+  }
+
+  SECTION("CompiledGraphKeepsBindingsOfRunningReplay") {
+    par::Executor executor(2);
+    std::atomic<bool> is_released = false;
+    auto input = par::Binding<const int>{};
+    auto output = par::Binding<int>{};
+    auto task_graph = par::TaskGraph{};
+    task_graph.add_task(par::make_task([&, input, output]() {
+      while (!is_released) {
+        std::this_thread::yield();
+      }
+      output.get() = 2 * input.get();
+    }));
+    auto compiled_graph = par::CompiledGraph{task_graph};
+    const auto first_input = 1;
+    auto first_output = 0;
+    REQUIRE(compiled_graph.reset());
+    input.bind(first_input);
+    output.bind(first_output);
+    auto first = executor.run(compiled_graph);
+    CHECK(compiled_graph.is_running());
+    // the second frame is refused before its inputs are bound
+    const auto second_input = 2;
+    auto second_output = 0;
+    CHECK_FALSE(compiled_graph.reset());
+    CHECK_THROWS_AS(executor.run(compiled_graph), std::runtime_error);
+    is_released = true;
+    first.wait();
+    CHECK(first_output == 2);
+    CHECK_FALSE(compiled_graph.is_running());
+    REQUIRE(compiled_graph.reset());
+    input.bind(second_input);
+    output.bind(second_output);
+    executor.run(compiled_graph).wait();
+    CHECK(first_output == 2);
+    CHECK(second_output == 4);
+  }
+
+  SECTION("StaticFlowCallsStagesInOrder") {
+    par::Executor executor(2);
+    std::vector<int> order;
+    auto flow = par::StaticFlow{[&]() { order.push_back(1); },
+                                [&]() { order.push_back(2); },
+                                [&]() { order.push_back(3); }};
+    auto task = flow.make_task("static flow");
+    executor.run(task);
+    executor.wait_for(task);
+    CHECK(order == std::vector<int>{1, 2, 3});
+  }
+
+  SECTION("StaticFlowPassesTileToEachStage") {
+    par::Executor executor(2);
+    const auto grid = par::TileGrid<Rect>{Rect{0, 0, 4, 4}, 2};
+    std::vector<int> areas(grid.get_tiles().size(), 0);
+    std::vector<int> visits(grid.get_tiles().size(), 0);
+    const auto measure = [&](const Rect &tile, size_t row, size_t col) {
+      areas[grid.index(row, col)] = tile.width * tile.height;
+    };
+    const auto visit = [&](const Rect &, size_t row, size_t col) {
+      visits[grid.index(row, col)]++;
+    };
+    auto task_graph = par::TaskGraph{};
+    for (auto &task :
+         par::parallel_for(grid, par::StaticFlow{measure, visit})) {
+      task_graph.add_task(task);
+    }
+    executor.run(task_graph);
+    executor.wait_for(task_graph);
+    CHECK(areas == std::vector<int>(4, 4));
+    CHECK(visits == std::vector<int>(4, 1));
+  }
+
+#if PAR_COROUTINES
+  SECTION("AsyncAwaitsTasksOnWorkers") {
+    par::Executor executor(2);
+    auto thread_id = std::this_thread::get_id();
+    auto async = double_on_worker(executor, 21, thread_id);
+    executor.spawn(async).wait();
+    CHECK(async.take_result() == 42);
+    CHECK(thread_id != std::this_thread::get_id());
+  }
+
+  SECTION("AsyncRethrowsException") {
+    par::Executor executor(2);
+    auto async = fail_on_worker(executor);
+    executor.spawn(async).wait();
+    CHECK_THROWS_AS(async.take_result(), std::runtime_error);
+  }
+#endif
+
+  SECTION("BatchedMailBoxCoalescesMessages") {
+    auto executor = std::make_shared<par::Executor>(1);
+    auto mail_box = par::MailBox{executor, par::Delivery::Batched};
+    auto addressee = std::make_shared<CountingAddressee>();
+    auto orchestrator = par::Orchestrator{addressee};
+    orchestrator.expect(mail_box);
+    // the only worker is busy until all messages have arrived
+    std::atomic<bool> is_released = false;
+    auto gate = par::make_task([&]() {
+      while (!is_released) {
+        std::this_thread::yield();
+      }
+    });
+    executor->run(gate);
+    for (int i = 0; i < 10; ++i) {
+      mail_box.arrived();
+    }
+    is_released = true;
+    for (int i = 0; i < 1000 && addressee->nb_received < 10; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(addressee->nb_received == 10);
+    CHECK(addressee->nb_deliveries == 1);
+  }
+
+  SECTION("BatchedMailBoxDeliversToAddresseesInParallel") {
+    auto executor = std::make_shared<par::Executor>(2);
+    auto mail_box = par::MailBox{executor, par::Delivery::Batched};
+    std::atomic<int> nb_receiving = 0;
+    std::atomic<int> nb_met = 0;
+    std::vector<par::Orchestrator> orchestrators;
+    for (int i = 0; i < 2; ++i) {
+      // each addressee waits until the other one receives too
+      auto addressee = std::make_shared<MeetingAddressee>(nb_receiving, nb_met);
+      orchestrators.emplace_back(addressee);
+      orchestrators.back().expect(mail_box);
+    }
+    mail_box.arrived();
+    for (int i = 0; i < 1000 && nb_met < 2; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(nb_met == 2);
+  }
+
+  SECTION("MailBoxRegistersConcurrentlyAndPrunesInactiveAddressees") {
+    auto mail_box = par::MailBox{};
+    std::vector<std::shared_ptr<CountingAddressee>> addressees;
+    for (int i = 0; i < 8; ++i) {
+      addressees.push_back(std::make_shared<CountingAddressee>());
+    }
+    std::vector<std::thread> threads;
+    for (auto &addressee : addressees) {
+      threads.emplace_back(
+          [&mail_box, addressee]() { mail_box.add(addressee); });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    addressees.front()->set_inactive();
+    mail_box.arrived();
+    CHECK(addressees.front()->nb_received == 0);
+    CHECK(std::all_of(addressees.begin() + 1, addressees.end(),
+                      [](const auto &addressee) {
+                        return addressee->nb_received == 1;
+                      }));
+    // the inactive addressee is dropped by the mail box
+    CHECK(addressees.front().use_count() == 1);
+  }
+
+  SECTION("PollContinuesOnceAwaitedCalcIsDone") {
+    par::Executor executor(2);
+    std::atomic<bool> is_released = false;
+    std::atomic<int> nb_continuations = 0;
+    auto calc = par::Calc<int()>{[&]() {
+      while (!is_released) {
+        std::this_thread::yield();
+      }
+      return 21;
+    }};
+    auto poll = par::Poll<int, int>{executor, calc, [&](int value) {
+                                      nb_continuations++;
+                                      return 2 * value;
+                                    }};
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    CHECK(nb_continuations == 0);
+    is_released = true;
+    poll.completion().wait();
+    CHECK(nb_continuations == 1);
+    CHECK(poll.result() == 42);
+    CHECK(calc.result() == 21);
+  }
+
+  SECTION("MpmcQueueIsBounded") {
+    auto queue = par::MpmcQueue<int>{3};
+    CHECK(queue.capacity() == 4);
+    for (int i = 0; i < 4; ++i) {
+      CHECK(queue.try_push(int{i}));
+    }
+    CHECK_FALSE(queue.try_push(4));
+    CHECK(queue.try_pop() == 0);
+    CHECK(queue.try_push(4));
+  }
+
+  SECTION("MpmcQueueDeliversEachValueOnce") {
+    auto queue = par::MpmcQueue<size_t>{64};
+    constexpr size_t nb_values = 10000;
+    std::atomic<size_t> nb_popped = 0;
+    std::atomic<size_t> sum = 0;
+    std::vector<std::thread> threads;
+    for (size_t producer = 0; producer < 2; ++producer) {
+      threads.emplace_back([&, producer]() {
+        for (size_t i = producer; i < nb_values; i += 2) {
+          while (!queue.try_push(size_t{i})) {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+    for (size_t consumer = 0; consumer < 2; ++consumer) {
+      threads.emplace_back([&]() {
+        while (nb_popped < nb_values) {
+          if (const auto value = queue.try_pop()) {
+            sum += *value;
+            nb_popped++;
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    CHECK(nb_popped == nb_values);
+    CHECK(sum == nb_values * (nb_values - 1) / 2);
+  }
+
+  SECTION("TryRunAdmitsLimitedNumberOfGraphs") {
+    par::Executor executor(2);
+    executor.set_admission_limits(par::AdmissionLimits{1, 0});
+    std::atomic<bool> is_released = false;
+    auto gated_graph = par::TaskGraph{};
+    gated_graph.add_task(par::make_task([&]() {
+      while (!is_released) {
+        std::this_thread::yield();
+      }
+    }));
+    auto other_graph = par::TaskGraph{};
+    other_graph.add_task(par::make_task([]() {}));
+    const auto gated = executor.try_run(gated_graph);
+    REQUIRE(gated);
+    CHECK_FALSE(executor.try_run(other_graph));
+    CHECK(executor.get_nb_graphs_in_flight() == 1);
+    auto releaser = std::thread{[&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      is_released = true;
+    }};
+    // waits for the gated graph to leave
+    const auto other = executor.try_run(other_graph, std::chrono::seconds{10});
+    releaser.join();
+    REQUIRE(other);
+    CHECK(is_released);
+    other->wait();
+    gated->wait();
+  }
+
+  SECTION("TryRunAdmitsLimitedNumberOfTasks") {
+    par::Executor executor(2);
+    executor.set_admission_limits(par::AdmissionLimits{0, 3});
+    std::atomic<bool> is_released = false;
+    auto gated_graph = par::TaskGraph{};
+    gated_graph.add_task(par::make_task([&]() {
+      while (!is_released) {
+        std::this_thread::yield();
+      }
+    }));
+    gated_graph.add_task(par::make_task([]() {}));
+    auto large_graph = par::TaskGraph{};
+    for (int i = 0; i < 5; ++i) {
+      large_graph.add_task(par::make_task([]() {}));
+    }
+    const auto gated = executor.try_run(gated_graph);
+    REQUIRE(gated);
+    CHECK_FALSE(executor.try_run(par::make_task([]() {})));
+    is_released = true;
+    // the admission is given back before waiters are released
+    gated->wait();
+    CHECK(executor.get_nb_graphs_in_flight() == 0);
+    // too large for the limit, but admitted as nothing else is in flight
+    const auto large = executor.try_run(large_graph);
+    REQUIRE(large);
+    large->wait();
+  }
+
+  SECTION("ExecutorTakesTurnsBetweenClients") {
+    par::Executor executor(1);
+    std::atomic<bool> is_released = false;
+    std::mutex mutex;
+    std::vector<std::string> order;
+    const auto make_graph = [&](const std::string &name) {
+      auto task_graph = par::TaskGraph{};
+      for (int i = 0; i < 3; ++i) {
+        task_graph.add_task(par::make_task([&, i, name]() {
+          std::unique_lock<std::mutex> lock(mutex);
+          order.push_back(name + std::to_string(i));
+        }));
+      }
+      return task_graph;
+    };
+    executor.run(par::make_task([&]() {
+      while (!is_released) {
+        std::this_thread::yield();
+      }
+    }));
+    const auto busy_client = executor.add_client();
+    const auto other_client = executor.add_client();
+    CHECK(busy_client != other_client);
+    auto busy = executor.run(make_graph("busy"), busy_client);
+    auto other = executor.run(make_graph("other"), other_client);
+    is_released = true;
+    busy.wait();
+    other.wait();
+    CHECK(order == std::vector<std::string>{"busy0", "other0", "busy1",
+                                            "other1", "busy2", "other2"});
+  }
+
+  SECTION("WorkStealingExecutorNeedsAWorker") {
+    CHECK_THROWS_AS(par::Executor(0, par::Scheduling::WorkStealing),
+                    std::runtime_error);
+  }
+
+  SECTION("FairReadyQueueForgetsClientsWithoutReadyTasks") {
+    auto queue = par::FairReadyQueue{};
+    const auto deadline = par::TimePoint::max();
+    for (par::ClientId client = 0; client < 3; ++client) {
+      queue.push(par::make_task([]() {}), deadline, 0, client);
+    }
+    queue.push(par::make_task([]() {}), deadline, 0, 0);
+    CHECK(queue.nb_clients() == 3);
+    const auto now = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < 3; ++i) {
+      CHECK(queue.pop(now));
+    }
+    CHECK(queue.nb_clients() == 1);
+    CHECK(queue.pop(now));
+    CHECK(queue.empty());
+    CHECK(queue.nb_clients() == 0);
+    queue.push(par::make_task([]() {}), deadline, 0, 1);
+    CHECK(queue.nb_clients() == 1);
+    CHECK(queue.pop(now));
+    CHECK(queue.empty());
+  }
+
+  SECTION("CalcKeepsArgumentTakenByValueBetweenRuns") {
+    par::Executor executor(2);
+    auto calc = par::Calc<size_t(std::vector<int>)>{
+        [](std::vector<int> values) { return values.size(); }};
+    calc.set_arg(std::vector<int>{1, 2, 3});
+    executor.run(calc.make_task()).wait();
+    CHECK(calc.take_result() == 3);
+    executor.run(calc.make_task()).wait();
+    CHECK(calc.take_result() == 3);
+  }
+
+  SECTION("CalcThenRunsContinuationOfFinishedCalc") {
+    par::Executor executor(2);
+    auto calc = par::Calc<int()>{[]() { return 21; }};
+    executor.run(calc.make_task());
+    executor.wait_for(calc.make_task());
+    auto continuation =
+        calc.then<int>(executor, std::function<int(int)>{
+                                     [](int value) { return 2 * value; }});
+    executor.wait_for(continuation.make_task());
+    CHECK(continuation.result() == 42);
+  }
+
+  SECTION("CalcThenRunsSeveralContinuationsOnOneResult") {
+    par::Executor executor(2);
+    auto calc = par::Calc<int()>{[]() { return 21; }};
+    auto doubled = calc.then<int>(
+        executor, std::function<int(int)>{[](int value) { return 2 * value; }});
+    auto incremented = calc.then<int>(
+        executor, std::function<int(int)>{[](int value) { return value + 1; }});
+    executor.run(calc.make_task());
+    executor.wait_for(doubled.make_task());
+    executor.wait_for(incremented.make_task());
+    CHECK(doubled.result() == 42);
+    CHECK(incremented.result() == 22);
+    CHECK(calc.result() == 21);
+  }
+
+  SECTION("CalcHandsOverMoveOnlyResults") {
+    par::Executor executor(2);
+    auto calc = par::Calc<std::unique_ptr<int>(std::unique_ptr<int>)>{
+        [](std::unique_ptr<int> value) {
+          *value *= 2;
+          return value;
+        }};
+    auto input = std::make_unique<int>(21);
+    const auto *address = input.get();
+    calc.set_arg(std::move(input));
+    executor.run(calc.make_task());
+    executor.wait_for(calc.make_task());
+    CHECK(*calc.result() == 42);
+    auto continuation = calc.then<std::unique_ptr<int>>(
+        executor, std::function<std::unique_ptr<int>(std::unique_ptr<int>)>{
+                      [](std::unique_ptr<int> value) { return value; }});
+    executor.wait_for(continuation.make_task());
+    const auto result = continuation.take_result();
+    CHECK(result.get() == address);
+    CHECK(*result == 42);
+  }
+}
+
+} // namespace
@@ -34,7 +34,6 @@ TEST_CASE("Preview", "[preview]") {
         break;
       }
 
-      video_preview.update_calculation_status();
       const auto frame_calculation_status =
           video_preview.get_frame_calculation_status();
       std::cout << "Frame status: "
@@ -94,7 +93,6 @@ TEST_CASE("Preview", "[preview]") {
         break;
       }
 
-      video_preview->update_calculation_status();
       const auto frame_calculation_status =
           video_preview->get_frame_calculation_status();
       std::cout << "Frame status: "
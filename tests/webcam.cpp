@@ -6,6 +6,8 @@
 #include "opencv2/imgproc/imgproc.hpp"
 
 #include <iostream>
+#include <optional>
+#include <stdexcept>
 
 namespace {
 
@@ -201,6 +203,96 @@ SECTION("WebcamProcessFrameSingleLoop") {
     CHECK(frame_data.all_rectangles.rectangles.size() > 500);
   }
 
+  SECTION("WebcamReplaysCompiledFrameGraphs") {
+    par::Executor executor(4);
+    int rings = 1;
+    int gradient_threshold = 15;
+    const auto path = std::string(CMAKE_SRC_DIR) + "/video/BillardTakeoff.mp4";
+
+    auto cap = cv::VideoCapture{path};
+    if (!cap.isOpened()) {
+      std::cout << "!!! Input video could not be opened" << std::endl;
+      throw std::runtime_error("Cannot open input video");
+    }
+    CHECK(cap.isOpened());
+
+    cv::Mat imgOriginal;
+    int retflag = -1;
+    webcam::read_image_data(cap, imgOriginal, retflag);
+
+    CHECK(retflag != 2);
+    if (retflag == 2) {
+      return;
+    }
+
+    const auto rectangle =
+        od::Rectangle{0, 0, imgOriginal.cols, imgOriginal.rows};
+    auto merge_objects_graph =
+        webcam::MergeObjectsGraph{rectangle, rings, gradient_threshold};
+    auto parallel_gradient_graph =
+        webcam::ParallelGradientGraph{rectangle, rings, gradient_threshold};
+    for (int frame = 0; frame < 2; ++frame) {
+      const auto merged_frame_data =
+          merge_objects_graph.process(imgOriginal, executor);
+      CHECK(merged_frame_data.all_rectangles.rectangles.size() > 500);
+
+      auto frame_data = webcam::FrameData{imgOriginal};
+      parallel_gradient_graph.run(executor, frame_data, imgOriginal).wait();
+      CHECK(frame_data.all_rectangles.rectangles.size() > 500);
+    }
+  }
+
+  SECTION("WebcamKeepsFrameOfRunningCompiledGraph") {
+    par::Executor executor(4);
+    int rings = 1;
+    int gradient_threshold = 15;
+    const auto path = std::string(CMAKE_SRC_DIR) + "/video/BillardTakeoff.mp4";
+
+    auto cap = cv::VideoCapture{path};
+    if (!cap.isOpened()) {
+      std::cout << "!!! Input video could not be opened" << std::endl;
+      throw std::runtime_error("Cannot open input video");
+    }
+    CHECK(cap.isOpened());
+
+    cv::Mat imgOriginal;
+    int retflag = -1;
+    webcam::read_image_data(cap, imgOriginal, retflag);
+
+    CHECK(retflag != 2);
+    if (retflag == 2) {
+      return;
+    }
+
+    const auto rectangle =
+        od::Rectangle{0, 0, imgOriginal.cols, imgOriginal.rows};
+    auto parallel_gradient_graph =
+        webcam::ParallelGradientGraph{rectangle, rings, gradient_threshold};
+    auto expected_frame_data = webcam::FrameData{imgOriginal};
+    parallel_gradient_graph.run(executor, expected_frame_data, imgOriginal)
+        .wait();
+
+    // the second frame comes while the first one is replayed
+    const cv::Mat black_frame = cv::Mat::zeros(imgOriginal.size(),
+                                               imgOriginal.type());
+    auto first_frame_data = webcam::FrameData{imgOriginal};
+    auto second_frame_data = webcam::FrameData{black_frame};
+    auto first =
+        parallel_gradient_graph.run(executor, first_frame_data, imgOriginal);
+    std::optional<par::Completion> second;
+    try {
+      second =
+          parallel_gradient_graph.run(executor, second_frame_data, black_frame);
+    } catch (const std::runtime_error &) {
+      // refused, the first frame was still running
+    }
+    first.wait();
+    if (second) {
+      second->wait();
+    }
+    CHECK(first_frame_data.all_rectangles.rectangles.size() ==
+          expected_frame_data.all_rectangles.rectangles.size());
+  }
 }
 
 } // namespace
\ No newline at end of file